@@ -0,0 +1,56 @@
+/*
+ * AnytimeOutput.h
+ *
+ *  Keeps the output file up to date with the best conflicting set so far. The
+ *  file is written aside and renamed over the output, so a reader never sees a
+ *  partly written file.
+ */
+
+#ifndef MCA_ANYTIMEOUTPUT_H_
+#define MCA_ANYTIMEOUTPUT_H_
+
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+
+#include "utils/System.h"
+#include "mca/SolverTypes.h"
+#include "mca/global_defs.h"
+
+namespace Minisat {
+
+class AnytimeOutput {
+	std::string  path;
+	std::string  tmpPath;
+	double       start;
+	int          nWrites;
+
+public:
+	AnytimeOutput(const char* path) : path(path), tmpPath(std::string(path) + ".tmp"), start(realTime()), nWrites(0) {}
+
+	/* replaces the output with the label, the set and a comment line with the time
+	 * (since the epoch and since the start) and the number of solver calls so far */
+	bool     write     (const char* label, const vec<Lit>& set, int calls);
+	int      nUpdates  () const     { return nWrites; }
+};
+
+bool AnytimeOutput::write(const char* label, const vec<Lit>& set, int calls)
+{
+	FILE* f = fopen(tmpPath.c_str(), "wb");
+	if (f == NULL) return false;
+	double now = realTime();
+	fprintf(f, "%s:\n", label);
+	foreach(i, set.size()) fprintf(f, "%s%s", (i==0)?"":" ", set[i].toString().c_str());
+	fprintf(f, "%s0\n", set.size() == 0 ? "" : " ");
+	fprintf(f, "c time %.3f elapsed %.3f calls %d size %d\n", now, now - start, calls, set.size());
+	fflush(f);
+	fsync(fileno(f));
+	fclose(f);
+	if (rename(tmpPath.c_str(), path.c_str()) != 0) return false;
+	nWrites++;
+	return true;
+}
+
+}
+
+#endif /* MCA_ANYTIMEOUTPUT_H_ */
@@ -0,0 +1,115 @@
+/*
+ * AssumGroups.h
+ *
+ *  Groups of assumptions that are added and removed as one unit. A group is
+ *  represented by its first literal: the minimisers only see the representatives,
+ *  which are expanded to the whole groups for the solver, and the conflicts of the
+ *  solver are mapped back to the representatives.
+ */
+
+#ifndef MCA_ASSUMGROUPS_H_
+#define MCA_ASSUMGROUPS_H_
+
+#include "mtl/Sort.h"
+#include "mca/Solver.h"
+#include "mca/global_defs.h"
+
+namespace Minisat {
+
+class AssumGroups {
+	vec<vec<Lit> >  groups;    // the literals of each group, the first one represents it
+	vec<int>        groupOf;   // by variable, the group of each member, -1 if it's in none
+
+	/* replaces every member (negated if neg) by its representative, only its first time */
+	void     replaceMembers (vec<Lit>& lits, bool neg) const;
+
+public:
+	/* the groups must be disjoint, and not share variables with the other assumptions */
+	AssumGroups(int nVars, const vec<vec<Lit> >& gs);
+
+	int      size           () const         { return groups.size(); }
+	bool     isGroup        (Lit l) const    { return var(l) < groupOf.size() && groupOf[var(l)] >= 0 && groups[groupOf[var(l)]][0] == l; }
+	/* appends the assumptions, with every representative expanded to its group */
+	void     expand         (const vec<Lit>& assum, vec<Lit>& out) const;
+	/* replaces the members in a set of literals / in a conflict (of negated literals)
+	 * by their representatives */
+	void     toReps         (vec<Lit>& lits) const      { replaceMembers(lits, false); }
+	void     mapConflict    (vec<Lit>& conflict) const  { replaceMembers(conflict, true); }
+	/* l (a representative or any other assumption) is satisfied by the model of s */
+	bool     satisfied      (const Solver& s, Lit l) const;
+};
+
+AssumGroups::AssumGroups(int nVars, const vec<vec<Lit> >& gs)
+{
+	groupOf.growTo(nVars, -1);
+	foreach(g, gs.size())
+	{
+		assert(gs[g].size() > 0);
+		groups.push();
+		gs[g].copyTo(groups.last());
+		foreach(i, gs[g].size()) groupOf[var(gs[g][i])] = g;
+	}
+}
+
+void AssumGroups::expand(const vec<Lit>& assum, vec<Lit>& out) const
+{
+	foreach(i, assum.size())
+	{
+		if (!isGroup(assum[i])) out.push(assum[i]);
+		else
+		{
+			const vec<Lit>& g = groups[groupOf[var(assum[i])]];
+			foreach(j, g.size()) out.push(g[j]);
+		}
+	}
+}
+
+void AssumGroups::replaceMembers(vec<Lit>& lits, bool neg) const
+{
+	/* the groups that are in lits, sorted, and whether each one was written yet.
+	 * no shared marks, the portfolio threads use the same groups */
+	vec<int>  found;
+	vec<char> written;
+	foreach(i, lits.size())
+		if (var(lits[i]) < groupOf.size() && groupOf[var(lits[i])] >= 0) found.push(groupOf[var(lits[i])]);
+	if (found.size() == 0) return;
+	sort(found);
+	int n = 0;
+	foreach(i, found.size()) if (i == 0 || found[i] != found[n - 1]) found[n++] = found[i];
+	found.shrink(found.size() - n);
+	written.growTo(n, 0);
+
+	int i, j;
+	for (i = j = 0; i < lits.size(); ++i)
+	{
+		Var v = var(lits[i]);
+		if (v >= groupOf.size() || groupOf[v] < 0)
+		{
+			lits[j++] = lits[i];
+			continue;
+		}
+		int k = 0, hi = n;
+		while (hi - k > 1)
+		{
+			int mid = (k + hi) / 2;
+			if (found[mid] <= groupOf[v]) k = mid; else hi = mid;
+		}
+		if (written[k]) continue;
+		written[k] = 1;
+		Lit rep = groups[groupOf[v]][0];
+		lits[j++] = neg ? ~rep : rep;
+	}
+	lits.shrink(i - j);
+}
+
+bool AssumGroups::satisfied(const Solver& s, Lit l) const
+{
+	if (!isGroup(l)) return s.modelValue(l) == l_True;
+	const vec<Lit>& g = groups[groupOf[var(l)]];
+	foreach(i, g.size()) if (s.modelValue(g[i]) != l_True) return false;
+	return true;
+}
+
+}
+
+#endif /* MCA_ASSUMGROUPS_H_ */
@@ -10,28 +10,13 @@
 
 #include "mca/Solver.h"
 #include "mtl/Queue.h"
+#include "mtl/Sort.h"
 #include "mca/global_defs.h"
 #include "mtl/Stack.h"
-
-#define INIT_ASSUM_BITMAP(bm)                 \
-	do                                        \
-    {                                         \
-        bm.clear();                           \
-	    foreach (i, initAssum.size())         \
-        {                                     \
-            bm.insert(initAssum[i], l_Undef); \
-         }                                    \
-    } while(0)
-
-#define INIT_ANTI_ASSUM_BITMAP(bm)            \
-	do                                        \
-    {                                         \
-        bm.clear();                           \
-	    foreach (i, initAssum.size())         \
-        {                                     \
-            bm.insert(~initAssum[i], l_Undef);\
-         }                                    \
-    } while(0)
+#include "mca/SolverPool.h"
+#include "mca/HittingSet.h"
+#include "mca/AnytimeOutput.h"
+#include "mca/AssumGroups.h"
 
 /*
 #define INIT_NON_ASSUM_BITMAP(bm)          \
@@ -70,7 +55,6 @@ public:
 	}
 };
 
-typedef Map<Lit, lbool, LitHash> lboolLitBitMap;
 typedef Map<Lit, bool, LitHash>  LitBitMap;
 typedef vec<Lit>                 sClause;  /* note that our definition of clause
                                            * is different from that of minisat */
@@ -81,8 +65,8 @@ typedef vec<Lit>                 sClause;  /* note that our definition of clause
 #define VITAL          8
 struct VarMetaData
 {
-	unsigned int  assum         : 1; // if this bit is set to 0, then the next bit is irrelevant
-	unsigned int  assumedTrue   : 1;
+	unsigned int  posAssum      : 1; // the positive literal is an assumption
+	unsigned int  negAssum      : 1; // the negative literal is an assumption
 	unsigned int  posDiscovered : 1; // if both discovered flags are 0, then index is irrelevant
 	unsigned int  negDiscovered : 1; // if both discovered flags are 0, then index is irrelevant
 	unsigned int  posInStack    : 1;
@@ -94,6 +78,207 @@ struct VarMetaData
 	unsigned int  index         : 24; // negatedV/varsMutualLiterals
 };
 
+/*
+ * The state of each assumption during a minimization: l_Undef - unknown, l_True - in the
+ * result, l_False - removed. It's indexed by literal, so both polarities of a variable can be
+ * assumptions, and a repeated assumption is kept once (at its first place). The assumptions
+ * that weren't removed are kept in a vector (in the order of the assumptions) that is
+ * compacted lazily, so building the assumptions of a call doesn't rescan the removed ones.
+ */
+class AssumState {
+	vec<Lit>    assum;
+	vec<lbool>  val;       // by literal
+	vec<int>    idx;       // the index in assum of each literal, -1 if it's not an assumption
+	vec<int>    active;    // sorted indices in assum of the assumptions that weren't removed (and of nStale that were)
+	vec<int>    restored;  // indices set back from l_False after compact() dropped them, merged into active lazily
+	vec<char>   inActive;  // by index in assum, it's in active or in restored
+	vec<char>   mark;      // by index in assum, temporary for the conflict filters
+	vec<Lit>    removed;   // the assumptions set to l_False since the last takeRemoved()
+	int         nStale;
+
+	void   compact     ();
+	void   mergeRestored();
+	/* sets the marks of the assumptions whose negation is in conflict */
+	void   markConflict(const vec<Lit>& conflict, char v);
+	bool   marked      (Lit l) const  { return has(l) && mark[idx[toInt(l)]]; }
+
+public:
+	AssumState() : nStale(0) {}
+
+	/* every assumption becomes l_Undef */
+	void   init        (const vec<Lit>& initAssum, int nVars);
+	bool   has         (Lit l) const  { return toInt(l) < idx.size() && idx[toInt(l)] >= 0; }
+	lbool  operator [] (Lit l) const  { assert(has(l)); return val[toInt(l)]; }
+	void   set         (Lit l, lbool v);
+	/* appends the assumptions that weren't removed, in order */
+	void   toVec       (vec<Lit>& out);
+	/* removes every assumption whose negation isn't in conflict (as returned by minisat) */
+	void   keepConflict(const vec<Lit>& conflict);
+	/* appends the assumptions removed since the last call that are still removed */
+	void   takeRemoved (vec<Lit>& out);
+	/* keeps only the literals of cands whose negation is in conflict, in their order.
+	 * Unlike keepConflict() these don't touch the values, only init() is needed */
+	void   filterByConflict     (vec<Lit>& cands, const vec<Lit>& conflict);
+	/* refills q with the literals of content whose negation is in conflict, the others
+	 * are appended to dropped. returns how many of the first nUntested are left */
+	int    filterQueueByConflict(Queue<Lit>& q, const vec<Lit>& content, int nUntested,
+	                             const vec<Lit>& conflict, vec<Lit>& dropped);
+};
+
+void AssumState::init(const vec<Lit>& initAssum, int nVars)
+{
+	foreach(i, assum.size()) idx[toInt(assum[i])] = -1;
+	initAssum.copyTo(assum);
+	idx.growTo(2 * nVars, -1);
+	val.growTo(2 * nVars, l_Undef);
+	active.clear();
+	restored.clear();
+	inActive.clear();
+	mark.clear();
+	removed.clear();
+	inActive.growTo(assum.size(), 0);
+	mark.growTo(assum.size(), 0);
+	foreach(i, assum.size())
+	{
+		if (idx[toInt(assum[i])] >= 0) continue;  // a repeated assumption
+		idx[toInt(assum[i])] = i;
+		val[toInt(assum[i])] = l_Undef;
+		active.push(i);
+		inActive[i] = 1;
+	}
+	nStale = 0;
+}
+
+void AssumState::set(Lit l, lbool v)
+{
+	assert(has(l));
+	lbool old = val[toInt(l)];
+	val[toInt(l)] = v;
+	if (v == l_False && old != l_False)
+	{
+		nStale++;
+		removed.push(l);
+	}
+	else if (v != l_False && old == l_False)
+	{
+		int i = idx[toInt(l)];
+		if (inActive[i])
+			nStale--;
+		else
+		{
+			/* put back in its place by the next mergeRestored() */
+			restored.push(i);
+			inActive[i] = 1;
+		}
+	}
+}
+
+void AssumState::mergeRestored()
+{
+	if (restored.size() == 0) return;
+	sort(restored);
+	int i = active.size() - 1, j = restored.size() - 1;
+	active.growTo(active.size() + restored.size());
+	for (int k = active.size() - 1; j >= 0; --k)
+		active[k] = (i >= 0 && active[i] > restored[j]) ? active[i--] : restored[j--];
+	restored.clear();
+}
+
+void AssumState::compact()
+{
+	mergeRestored();
+	int i, j;
+	for (i = j = 0; i < active.size(); ++i)
+	{
+		if (val[toInt(assum[active[i]])] == l_False)
+			inActive[active[i]] = 0;
+		else
+			active[j++] = active[i];
+	}
+	active.shrink(i - j);
+	nStale = 0;
+}
+
+void AssumState::toVec(vec<Lit>& out)
+{
+	mergeRestored();
+	if (2 * nStale > active.size()) compact();
+	foreach(i, active.size())
+	{
+		Lit l = assum[active[i]];
+		if (val[toInt(l)] != l_False) out.push(l);
+	}
+}
+
+void AssumState::markConflict(const vec<Lit>& conflict, char v)
+{
+	foreach(i, conflict.size())
+		if (has(~conflict[i])) mark[idx[toInt(~conflict[i])]] = v;
+}
+
+void AssumState::keepConflict(const vec<Lit>& conflict)
+{
+	mergeRestored();
+	markConflict(conflict, 1);
+	foreach(i, active.size())
+	{
+		int  k = active[i];
+		Lit  l = assum[k];
+		if (!mark[k] && val[toInt(l)] != l_False)
+		{
+			assert(val[toInt(l)] != l_True);
+			set(l, l_False);
+		}
+	}
+	markConflict(conflict, 0);
+	compact();
+}
+
+void AssumState::filterByConflict(vec<Lit>& cands, const vec<Lit>& conflict)
+{
+	int j = 0;
+	markConflict(conflict, 1);
+	foreach(i, cands.size())
+		if (marked(cands[i])) cands[j++] = cands[i];
+	cands.shrink(cands.size() - j);
+	markConflict(conflict, 0);
+}
+
+int AssumState::filterQueueByConflict(Queue<Lit>& q, const vec<Lit>& content, int nUntested,
+                                      const vec<Lit>& conflict, vec<Lit>& dropped)
+{
+	int res = 0;
+	markConflict(conflict, 1);
+	q.clear();
+	foreach(i, content.size())
+	{
+		if (!marked(content[i])) {
+			dropped.push(content[i]);
+			continue;
+		}
+		q.insert(content[i]);
+		if (i < nUntested) res++;
+	}
+	markConflict(conflict, 0);
+	return res;
+}
+
+void AssumState::takeRemoved(vec<Lit>& out)
+{
+	foreach(i, removed.size())
+		if (val[toInt(removed[i])] == l_False) out.push(removed[i]);
+	removed.clear();
+}
+
+/* a literal on the stack of the rotation, and the next of its potential literals to explore */
+struct RotationFrame
+{
+	Lit  lit;
+	int  next;
+	int  vitalsBegin, vitalsEnd; // the new vitals found when lit was pushed
+	RotationFrame(Lit l = lit_Undef) : lit(l), next(0), vitalsBegin(0), vitalsEnd(0) {}
+};
+
 
 
 
@@ -174,19 +359,30 @@ vec<Lit>* getMutualAssumptionsInClauses(vec<vec<Lit>*>& clauses, vec<Lit>& assum
 	return res;
 }
 
+/* sorts indices by their keys, ties are kept in the original order */
+struct IndexKeyLt
+{
+	const vec<double>& keys;
+	IndexKeyLt(const vec<double>& keys) : keys(keys) {}
+	bool operator () (int i, int j) const { return keys[i] < keys[j] || (keys[i] == keys[j] && i < j); }
+};
+
+/* thrown when a solver call is interrupted (l_Undef), the minimization can't go on */
+class InterruptedException{};
+
 class AssumMinimiser {
     Solver&         s;
-    vec<Lit>        initAssum; // Must not be edited after c'tor !!!
-    lboolLitBitMap  litBitMap;
+    vec<Lit>        initAssum; // Must not be edited after c'tor, except for orderAssumptions() !!!
+    AssumState      state;
 
     // TODO: add flags for solver limitations: yield after a certain number of conflicts, time, decisions...
 
     //Statistics TODO might want to add run times for SAT, UNSAT separately
     int             nSAT,
 	                nUNSAT;
-    int             nSolveCalls() const         { return nSAT+nUNSAT; }
     lbool           isSatWith,
 	                isSatWo;         //specifies if the formula is sat without assum
+    vec<Lit>        initConflict;    // s.conflict of the initial UNSAT call with all of initAssum
 
     VarMetaData        *vars;
 	vec<vec<Lit>*>  posVarClauses;
@@ -194,6 +390,26 @@ class AssumMinimiser {
 
 	int             rotDepth;
 
+	int64_t         confBudget,      // budgets of each solver call, 0 means no budget
+	                propBudget;
+	double          budgetInc;       // a call that runs out of budget is retried with a budget this much larger
+	int             nRetries;
+	bool            haveBest;
+	vec<Lit>        best;            // the smallest conflicting set seen so far (an over-approximation)
+	AnytimeOutput  *stream;          // if not NULL, every new best set is written to it
+
+	int             nThreads;        // number of worker solvers for the parallel algorithms
+	SolverPool     *pool;            // the worker solvers, while a parallel algorithm runs
+	bool            harden;          // add the critical assumptions to s as unit clauses
+	vec<char>       hard;            // by literal, the assumption was added as a unit clause
+	int             nHardened;
+	bool            retire;          // fix the removed assumptions false in s, see setRetire()
+	vec<char>       retired;         // by literal
+	int             nRetired;
+	const AssumGroups *groups;       // if not NULL, some of the assumptions represent groups
+	vec<int>        weights;         // by literal, empty if the assumptions aren't weighted
+	MinHittingSet  *hitter;          // the hitting set solver, while smallestMus runs
+
     // TODO statistics for per SAT, UNSAT (cpu_time), initial run.
     // assumptions progress along the way and in the end.
 
@@ -215,18 +431,50 @@ class AssumMinimiser {
      * */
 
     lbool        solveWithAssum(vec<Lit>& assum);
-    // create vector of assumptions based on a bitmap masked on init assum.
-    //INVARIANT: the assum is a subset of init assum!
-    void         litBitMapToVec(vec<Lit>& assum);
-    // create bit map of literals based on the vector assum.
-    //INVARIANT: same as previous method + assum is created by minisat!
-    void 		 vecToLitBitMap(const vec<Lit>& assum);
-
-    bool         isAssum(Lit l) { /* TODO: can be modified to use VarMetaData */
-    	foreach(i, initAssum.size()) if (initAssum[i] == l) return true; return false;
+    /* s.solveLimited within the budgets, throws InterruptedException if s was interrupted */
+    lbool        solveBudgeted (const vec<Lit>& assum);
+    /* keeps the conflict (of an UNSAT call) if it's the lightest one so far (the smallest
+     * without weights), must be called after the call was counted */
+    void         noteConflict  (const vec<Lit>& conflict);
+    /* if hardening, adds the critical assumption to s as a unit clause. It must stay in
+     * the assumptions of every later call of this minimization */
+    void         hardenCritical(Lit l);
+    void         markCritical  (Lit l)   { state.set(l, l_True); hardenCritical(l); }
+    /* if retiring, fixes the removed assumptions false in s, so s.simplify() removes the
+     * clauses they guard. Only the assumptions that don't occur in any clause (only their
+     * negation does, like the selectors of pp.sh) are fixed, so the answers don't change */
+    void         retireRemoved (const vec<Lit>& removed);
+    void         retireRemoved ()        { vec<Lit> removed; state.takeRemoved(removed); retireRemoved(removed); }
+    /* l is satisfied by the last model of s, all of its group if it represents one */
+    bool         assumSatisfied(Lit l) const { return groups != NULL ? groups->satisfied(s, l) : s.modelValue(l) == l_True; }
+    /* solves the workers with the assumptions (with the groups expanded), the conflicts
+     * are mapped back to the assumptions */
+    void         solveWorkers  (SolverPool& workers, const vec<vec<Lit> >& assums, vec<lbool>& rets);
+    // appends the assumptions that weren't removed from the state, in the order of init assum.
+    void         stateToVec(vec<Lit>& assum)             { state.toVec(assum); }
+    // removes the assumptions that aren't in the conflict from the state.
+    //INVARIANT: the conflict is created by minisat from a subset of init assum!
+    void 		 keepConflict(const vec<Lit>& conflict) { state.keepConflict(conflict); }
+    // checks that every assumption of conflict is still in the state
+    bool         isConflictInWorkingSet(const vec<Lit>& conflict);
+
+    bool         isAssum(Lit l) {
+    	return sign(l) ? vars[var(l)].negAssum : vars[var(l)].posAssum;
     }
     bool         isConfWithAssum(Lit l) { return isAssum(~l); }
 
+    /* keeps only the literals of cands whose negation is in conflict, see AssumState.
+     * the state must be initialised with initAssum */
+    void         filterByConflict(vec<Lit>& cands, const vec<Lit>& conflict)
+                                             { state.filterByConflict(cands, conflict); }
+    /* one step of QuickXplain, see quickXplain() */
+    void         quickXplainRec(vec<Lit>& bg, bool testBg, vec<Lit>& cands, vec<Lit>& out);
+    /* helpers of iterativeIns */
+    void         prefixWithResult(const vec<Lit>& result, const vec<Lit>& cands, int len, vec<Lit>& out);
+    int          skipSatisfiedCands(const vec<Lit>& cands, int from);
+    /* helper of smallestMus, extends the satisfiable set (given by the indices in initAssum
+     * of its assumptions) to a maximal one, its complement is a minimal correction set */
+    void         growToCorrectionSet(vec<char>& inSet, vec<int>& mcs);
 
 
 public:
@@ -234,26 +482,33 @@ public:
     AssumMinimiser(Solver& s, vec<Lit>& assum) : s(s), initAssum(), isSatWith(l_Undef),
                                                  isSatWo(l_Undef), vars(NULL),
 												 posVarClauses(), negVarClauses(),
-												 rotDepth(100)
+												 rotDepth(100), confBudget(0), propBudget(0), budgetInc(2),
+												 nRetries(0), haveBest(false), stream(NULL),
+												 nThreads(1), pool(NULL), harden(false), nHardened(0),
+												 retire(false), nRetired(0), groups(NULL), hitter(NULL)
     {
 #define X(s) curr_##s = 0, total_##s = 0
     	SOLVER_STATS_TABLE;
 #undef X
     	curr_cpu_time = total_cpu_time = 0;
-        initAssum.copyFrom(assum);
+        /* a repeated assumption is kept once, at its first place */
+        vec<char> seen(2 * s.nVars(), 0);
+        foreach(a, assum.size())
+            if (!seen[toInt(assum[a])]) seen[toInt(assum[a])] = 1, initAssum.push(assum[a]);
         nSAT = nUNSAT = 0;
         isSatWith = isSatWo = l_Undef;
         verbosity = s.verbosity;
-        litBitMap.clear();
         vars = new VarMetaData[s.nVars()](); // operator () at the end initializes the arr to zero
         foreach(a, initAssum.size())
        	{
-            vars[var(initAssum[a])].assum = 1;
-            vars[var(initAssum[a])].assumedTrue =
-            		!sign(initAssum[a]); /* sign returns true if var is negated */
+            if (sign(initAssum[a])) /* sign returns true if var is negated */
+                vars[var(initAssum[a])].negAssum = 1;
+            else
+                vars[var(initAssum[a])].posAssum = 1;
         }
         TRACE("Init assums are: " << initAssum.toString());
     }
+    ~AssumMinimiser() { delete[] vars; }
 
     bool isVarMarked(Var v)
     {
@@ -281,6 +536,10 @@ public:
 
     void unmarkLit(Lit l);
 
+    /* the potential literals of ~l, computed once while l is marked */
+    const vec<Lit>& potentialLiterals(Lit l);
+    bool     testPotentialVitals(vec<lbool>& model, RotationFrame& frame, vec<Lit>& newVitals);
+
     /** These two methods checks if the formula is SAT with and without the assumptions
      * respectively, if it's SAT with the assumptions or UNSAT without the assumptions, then
      * minimizing the conflicting assumptions is irrelevant or trivial - respectively.
@@ -293,13 +552,95 @@ public:
     void     iterativeDel  (vec<Lit> &result);
     void     iterativeDel2 (vec<Lit> &result);
     /*
-     * Implementations of the simple Iterative Insertion
+     * Iterative Deletion of whole chunks of assumptions, the chunk size is
+     * halved after a SAT answer and doubled after an UNSAT answer
+     * */
+    void     chunkedDel    (vec<Lit> &result);
+    /*
+     * Iterative Deletion that tests the removal of the next nThreads candidates
+     * at once on worker solvers, the answers are merged in order
+     * */
+    void     parallelDel   (vec<Lit> &result);
+    void     setThreads    (int n)           { nThreads = n; }
+    void     setBudgets    (int64_t conf, int64_t prop, double inc)
+                                             { confBudget = conf; propBudget = prop; budgetInc = inc; }
+    /* the smallest conflicting set known, which is what's left when a minimization
+     * is interrupted. returns false if no call was UNSAT yet */
+    bool     bestSoFar     (vec<Lit>& out) const { if (haveBest) best.copyTo(out); return haveBest; }
+    void     setStream     (AnytimeOutput* out) { stream = out; }
+    /* the deletion algorithms (1, 2, 4 and 6, see canHarden()) add every assumption they
+     * prove critical to the solver as a unit clause, so it's no longer a decision in the
+     * later calls. The other algorithms don't harden anything.
+     * NOTE: the solver keeps these clauses, it mustn't be used for other assumptions */
+    void     setHarden     (bool b)            { harden = b; }
+    static bool canHarden  (int alg)           { return alg == 1 || alg == 2 || alg == 4 || alg == 6; }
+    /* the deletion algorithms (1, 2, 4 and 6, see canHarden()) fix every assumption they
+     * remove for good to false, so the clauses that it guards leave the solver.
+     * NOTE: like setHarden(), the solver mustn't be used for other assumptions */
+    void     setRetire     (bool b)            { retire = b; }
+    /* the assumptions that represent groups (see AssumGroups), must be called before
+     * isSatWithAssum(). The results are given by the representatives */
+    void     setGroups     (const AssumGroups* g);
+    /* appends the assumptions, with the groups expanded */
+    void     expandGroups  (const vec<Lit>& assum, vec<Lit>& out) const;
+    /* the weight of each assumption, w[i] of assum[i] (or of its group). Without weights
+     * every assumption weighs 1, and the weight of a set is its size */
+    void     setWeights    (const vec<Lit>& assum, const vec<int>& w);
+    bool     weighted      () const            { return weights.size() > 0; }
+    int      weightOf      (Lit l) const       { return weighted() ? weights[toInt(l)] : 1; }
+    /* the weight of a set of assumptions, or of a conflict (their negations) */
+    int64_t  weight        (const vec<Lit>& set) const;
+
+    /* orderings of the assumptions, the algorithms try to remove the first ones first */
+    enum     { OrderFile, OrderActivity, OrderOccurrence, OrderConflict, OrderRandom, OrderWeight };
+    static int orderByName (const char* name);   // -1 if there's no such ordering
+    /* reorders the assumptions, must be called after isSatWithAssum() and before minimizing.
+     * seed is used by OrderRandom only */
+    void     orderAssumptions(int order, double seed);
+    const vec<Lit>& assumptions() const      { return initAssum; }
+    /*
+     * Repeated core trimming: solves again with the previous conflict as the assumptions,
+     * shuffled, until the conflict stops shrinking or after maxRounds rounds. The
+     * algorithms start from the last conflict. returns the number of rounds
+     * */
+    int      trimCore      (int maxRounds, double seed);
+    /* interrupts the solver and the worker solvers, safe to call from a signal handler */
+    void     interrupt     ()                { s.interrupt(); if (pool != NULL) pool->interrupt();
+                                                if (hitter != NULL) hitter->interrupt(); }
+    /*
+     * Iterative Insertion with exponential progression: candidates are added
+     * 1, 2, 4, ... at a time until UNSAT, then the transition assumption is
+     * found by binary search
      * */
     void     iterativeIns  (vec<Lit> &result);
 
     void     rotationAlg   (vec<Lit> &result);
+    /*
+     * Divide and conquer minimization (QuickXplain), needs O(k*log(n/k))
+     * solver calls when the minimal set is of size k
+     * */
+    void     quickXplain   (vec<Lit> &result);
+    /*
+     * Smallest conflicting set by hitting set duality: a minimum hitting set of the
+     * correction sets found so far is either UNSAT (and then it's the smallest set) or
+     * it's grown to one more correction set. The bounds are reported as they improve,
+     * if it's interrupted then the best (minimal) set found so far is the result.
+     * With weights, it's the conflicting set of minimum total weight.
+     * */
+    void     smallestMus   (vec<Lit> &result);
+    /*
+     * The assumptions that are in every minimal conflicting set (their intersection),
+     * an assumption is in all of them iff the rest of the assumptions are SAT. The
+     * checks are independent, they run on nThreads worker solvers at once
+     * */
+    void     necessaryAssums(vec<Lit> &result);
+
+    /* runs the algorithm given by its -alg number */
+    void     minimise      (int alg, vec<Lit> &result);
+    static const char* algName(int alg);
 
     void     printCurrentStats();
+    int      nSolveCalls   () const          { return nSAT+nUNSAT; }
 
     void     PrintStats    () const;
 
@@ -309,7 +650,7 @@ public:
 	                       (vec<lbool>& model,
 	                        Lit assum,
 							vec<Lit>& newVital,
-							int recursionDepth);
+							int maxDepth);
 ;
 };
 
@@ -319,6 +660,129 @@ void     AssumMinimiser::PrintStats    () const {
 	printf("num of SAT calls      : %d\n", nSAT);
 	printf("num of UNSAT calls    : %d\n", nUNSAT);
 	printf("total calls           : %d\n", nSolveCalls());
+	if (confBudget > 0 || propBudget > 0)
+		printf("budget retries        : %d\n", nRetries);
+	if (harden)
+		printf("hardened assumptions  : %d\n", nHardened);
+	if (retire)
+		printf("retired assumptions   : %d\n", nRetired);
+}
+
+lbool    AssumMinimiser::solveBudgeted(const vec<Lit>& assum) {
+    int64_t conf = confBudget, prop = propBudget;
+    vec<Lit> expanded;
+    if (groups != NULL) groups->expand(assum, expanded);
+    for (;;) {
+        s.budgetOff();
+        if (conf > 0) s.setConfBudget(conf);
+        if (prop > 0) s.setPropBudget(prop);
+        lbool ret = s.solveLimited(groups != NULL ? expanded : assum);
+        if (ret != l_Undef) {
+            s.budgetOff();
+            if (ret == l_False && groups != NULL) groups->mapConflict(s.conflict);
+            return ret;
+        }
+        if (s.interrupted() || (conf <= 0 && prop <= 0)) {
+            TRACE("INTERRUPTED");
+            s.budgetOff();
+            throw InterruptedException();
+        }
+        TRACE("Out of budget, retrying");
+        nRetries++;
+        conf = (int64_t)(conf * budgetInc);
+        prop = (int64_t)(prop * budgetInc);
+    }
+}
+
+void     AssumMinimiser::noteConflict(const vec<Lit>& conflict) {
+    if (haveBest && weight(conflict) >= weight(best)) return;
+    best.clear();
+    foreach(i, conflict.size()) best.push(~conflict[i]);
+    haveBest = true;
+    if (stream == NULL) return;
+    vec<Lit> out;
+    expandGroups(best, out);
+    if (!stream->write("Conflicting Assumptions (not minimal)", out, nSolveCalls()))
+        printf("WARNING! Could not write the conflicting set so far\n");
+}
+
+void     AssumMinimiser::hardenCritical(Lit l) {
+    if (!harden) return;
+    hard.growTo(2 * s.nVars(), 0);
+    if (hard[toInt(l)]) return;
+    TRACE("Hardening " << l.toString());
+    hard[toInt(l)] = 1;
+    nHardened++;
+    /* if l alone is conflicting, s becomes UNSAT with an empty conflict, and l is added back */
+    vec<Lit> lits, one;
+    one.push(l);
+    expandGroups(one, lits);
+    foreach(i, lits.size()) if (!s.addClause(lits[i])) return;
+    s.simplify();
+}
+
+void     AssumMinimiser::setGroups(const AssumGroups* g) {
+    groups = g;
+    /* the rotation flips single variables, it can't tell when a group becomes critical */
+    foreach(i, initAssum.size())
+        if (g != NULL && g->isGroup(initAssum[i])) {
+            if (sign(initAssum[i])) vars[var(initAssum[i])].negAssum = 0;
+            else                    vars[var(initAssum[i])].posAssum = 0;
+        }
+}
+
+void     AssumMinimiser::setWeights(const vec<Lit>& assum, const vec<int>& w) {
+    weights.clear();
+    weights.growTo(2 * s.nVars(), 1);
+    foreach(i, assum.size()) weights[toInt(assum[i])] = w[i];
+}
+
+int64_t  AssumMinimiser::weight(const vec<Lit>& set) const {
+    if (!weighted()) return set.size();
+    int64_t sum = 0;
+    foreach(i, set.size()) sum += weights[toInt(set[i])];
+    return sum;
+}
+
+void     AssumMinimiser::expandGroups(const vec<Lit>& assum, vec<Lit>& out) const {
+    if (groups != NULL) groups->expand(assum, out);
+    else foreach(i, assum.size()) out.push(assum[i]);
+}
+
+void     AssumMinimiser::solveWorkers(SolverPool& workers, const vec<vec<Lit> >& assums, vec<lbool>& rets) {
+    if (groups == NULL) {
+        workers.solveAll(assums, rets);
+        return;
+    }
+    vec<vec<Lit> > expanded(assums.size());
+    foreach(k, assums.size()) groups->expand(assums[k], expanded[k]);
+    workers.solveAll(expanded, rets);
+    foreach(k, assums.size())
+        if (rets[k] == l_False) groups->mapConflict(workers[k].conflict);
+}
+
+void     AssumMinimiser::retireRemoved(const vec<Lit>& removed) {
+    if (!retire) return;
+    retired.growTo(2 * s.nVars(), 0);
+    int n = nRetired;
+    vec<Lit> lits, one;
+    foreach(i, removed.size()) {
+        if (retired[toInt(removed[i])]) continue;
+        retired[toInt(removed[i])] = 1;
+        /* every literal of a group is fixed on its own */
+        lits.clear();
+        one.clear();
+        one.push(removed[i]);
+        expandGroups(one, lits);
+        foreach(j, lits.size()) {
+            Lit l = lits[j];
+            if (s.value(l) != l_Undef || s.nClausesContaining(l) > 0) continue;
+            TRACE("Retiring " << l.toString());
+            nRetired++;
+            s.addClause(~l);
+        }
+    }
+    if (nRetired > n) s.simplify();
 }
 
 lbool    AssumMinimiser::solveWithAssum(vec<Lit>& assum) {
@@ -328,7 +792,18 @@ lbool    AssumMinimiser::solveWithAssum(vec<Lit>& assum) {
     {
     	return isSatWoAssum();
     }
-    ret = s.solveLimited(assum);
+    if (nHardened > 0) {
+        /* the hardened assumptions are propagated at level 0, so they are never in the
+         * conflict, but they are part of it */
+        vec<Lit> soft, hardIn;
+        foreach(i, assum.size()) {
+            if (hard[toInt(assum[i])]) hardIn.push(assum[i]);
+            else                     soft.push(assum[i]);
+        }
+        ret = solveBudgeted(soft);
+        if (ret == l_False) foreach(i, hardIn.size()) s.conflict.push(~hardIn[i]);
+    } else
+        ret = solveBudgeted(assum);
     TRACE("Solving ended");
     if (ret == l_True) {
         TRACE("SAT");
@@ -336,51 +811,24 @@ lbool    AssumMinimiser::solveWithAssum(vec<Lit>& assum) {
     } else {
         TRACE("UNSAT");
         nUNSAT++;
+        noteConflict(s.conflict);
     }
-    printCurrentStats();
+    if (verbosity > 0) printCurrentStats();
     return ret;
 }
 
-void AssumMinimiser::litBitMapToVec(vec<Lit>& assum) {
-	foreach(i, initAssum.size()) {
-		if (litBitMap[initAssum[i]] != l_False)
-			assum.push(initAssum[i]);
-	}
-}
-
-void AssumMinimiser::vecToLitBitMap(const vec<Lit>& assum) {
-    //Lit negLit;
-    TRACE_START_FUNC;
-    foreach(i, initAssum.size()) {
-    	if (!assum.contains(~initAssum[i])) {
-    		assert(litBitMap[initAssum[i]] != l_True);
-    		litBitMap[initAssum[i]] = l_False;
-    	}
-	}
-    foreach(i, assum.size()) {
-        TRACE(assum[i].toString());
-    }
-//    foreach(i, assum.size()) {
-//    	/* minisat saves the literal negated,
-//    	 * so we negate it back to get the right value. */
-//        negLit = ~assum[i];
-//	    TRACE("Adding Lit = " << negLit.toString());
-//		assert(litBitMap.has(negLit));
-//		litBitMap[negLit] = l_True;
-//	}
-    TRACE_END_FUNC;
-}
-
 lbool AssumMinimiser::isSatWithAssum() {
     if (isSatWith == l_Undef) {
-        isSatWith = s.solveLimited(initAssum);
+        isSatWith = solveBudgeted(initAssum);
         if (isSatWith == l_True){
         	isSatWo = l_True;
         	nSAT++;
         } else {
+        	s.conflict.copyTo(initConflict);
         	nUNSAT++;
+        	noteConflict(initConflict);
         }
-        printCurrentStats();
+        if (verbosity > 0) printCurrentStats();
     }
     //if (isSatWith) TRACE()
     return isSatWith;
@@ -389,14 +837,15 @@ lbool AssumMinimiser::isSatWithAssum() {
 
 lbool AssumMinimiser::isSatWoAssum() {
     if (isSatWo == l_Undef) {
-        isSatWo = s.solveLimited(vec<Lit>());
+        isSatWo = solveBudgeted(vec<Lit>());
         if (isSatWo == l_False) {
         	isSatWith = l_False;
         	nUNSAT++;
+        	noteConflict(s.conflict);
         } else {
         	nSAT++;
         }
-        printCurrentStats();
+        if (verbosity > 0) printCurrentStats();
     }
     return isSatWo;
 }
@@ -405,24 +854,43 @@ void AssumMinimiser::iterativeDel(vec<Lit> &result) {
     Lit p = lit_Undef;
     lbool ret;
     result.clear(false);
-    vec<Lit> vecAssum;
+    vec<Lit> vecAssum, removed;
     Queue<Lit> currAssum;
-    currAssum.fromVec(initAssum);
+    int nUntested; /* INVARIANT: the untested assumptions are in the front of currAssum */
 
     if (isSatWithAssum() == l_True) return;
 
-    foreach(i, initAssum.size()) {
+    state.init(initAssum, s.nVars());
+    initAssum.copyTo(vecAssum);
+    filterByConflict(vecAssum, initConflict);
+    if (retire) {
+        vec<char> kept(2 * s.nVars(), 0);
+        foreach(i, vecAssum.size()) kept[toInt(vecAssum[i])] = 1;
+        foreach(i, initAssum.size()) if (!kept[toInt(initAssum[i])]) removed.push(initAssum[i]);
+        retireRemoved(removed);
+    }
+    currAssum.fromVec(vecAssum);
+    nUntested = currAssum.size();
+
+    while (nUntested > 0) {
         p = currAssum.peek();
         TRACE("Removing " << p.toString() << " from currAssum");
         currAssum.pop();
+        nUntested--;
         currAssum.toVec(vecAssum);
         ret = solveWithAssum(vecAssum);
         if (ret == l_True) {
         	TRACE(p.toString() << " is essential");
         	TRACE("Added it back to currAssum");
             currAssum.insert(p);
+            hardenCritical(p);
         } else {
-        	TRACE(p.toString() << " isn't essential");
+        	TRACE(p.toString() << " isn't essential" << std::endl
+        			<< "Updating current assumptions");
+        	removed.clear();
+        	removed.push(p);
+        	nUntested = state.filterQueueByConflict(currAssum, vecAssum, nUntested, s.conflict, removed);
+        	retireRemoved(removed);
         }
         vecAssum.clear(true);
     }
@@ -437,29 +905,154 @@ void AssumMinimiser::iterativeDel2(vec<Lit> &result) {
 
     if (isSatWithAssum() == l_True) return;
 
-    INIT_ASSUM_BITMAP(litBitMap);
+    state.init(initAssum, s.nVars());
+    keepConflict(initConflict);
+    retireRemoved();
 
     foreach(i, initAssum.size()) {
-        if(litBitMap[initAssum[i]] == l_False) continue;
-        litBitMap[initAssum[i]] = l_False;
+        if(state[initAssum[i]] == l_False) continue;
+        state.set(initAssum[i], l_False);
         TRACE("Removing " << initAssum[i].toString() << " from bitMap");
-        litBitMapToVec(vecAssum);
+        stateToVec(vecAssum);
         ret = solveWithAssum(vecAssum);
         if (ret == l_True) {
         	TRACE(initAssum[i].toString() << " is essential");
         	TRACE("Added it back to currAssum");
-            litBitMap[initAssum[i]] = l_True;
+            markCritical(initAssum[i]);
         } else {
         	TRACE(initAssum[i].toString() << " isn't essential" << std::endl
         			<< "Updating current assumptions");
-        	vecToLitBitMap(s.conflict);
+        	keepConflict(s.conflict);
+        	retireRemoved();
+        }
+        vecAssum.clear(true);
+    }
+    stateToVec(result);
+    return;
+}
+
+void AssumMinimiser::chunkedDel(vec<Lit> &result) {
+    lbool ret;
+    result.clear(false);
+    vec<Lit> vecAssum;
+    vec<Lit> chunk;
+    int      chunkSize = 1;
+    int      i = 0;
+
+    if (isSatWithAssum() == l_True) return;
+
+    state.init(initAssum, s.nVars());
+    keepConflict(initConflict);
+    retireRemoved();
+
+    while (true) {
+        /* skipping the assumptions that are already determined */
+        while (i < initAssum.size() && state[initAssum[i]] != l_Undef) i++;
+        if (i == initAssum.size()) break;
+
+        chunk.clear();
+        for (int j = i; j < initAssum.size() && chunk.size() < chunkSize; ++j) {
+            if (state[initAssum[j]] != l_Undef) continue;
+            chunk.push(initAssum[j]);
+            state.set(initAssum[j], l_False);
+        }
+        TRACE("Removing chunk " << chunk.toString() << " from bitMap");
+        stateToVec(vecAssum);
+        ret = solveWithAssum(vecAssum);
+        if (ret == l_True) {
+            if (chunk.size() == 1) {
+                TRACE(chunk[0].toString() << " is essential");
+                markCritical(chunk[0]);
+            } else {
+                TRACE("Chunk is essential, retrying with a smaller one");
+                foreach(j, chunk.size()) state.set(chunk[j], l_Undef);
+            }
+            chunkSize = chunkSize > 1 ? chunkSize / 2 : 1;
+        } else {
+            TRACE("Chunk isn't essential" << std::endl << "Updating current assumptions");
+            keepConflict(s.conflict);
+            retireRemoved();
+            if (chunkSize < initAssum.size()) chunkSize *= 2;
         }
         vecAssum.clear(true);
     }
-    litBitMapToVec(result);
+    stateToVec(result);
     return;
 }
 
+/*
+ * Every round, worker k tests the current working set without the k'th next undetermined
+ * candidate. The answers are merged in order: a SAT answer proves its candidate is vital
+ * (for every subset of the working set as well), an UNSAT answer's conflict replaces the
+ * working set only if it is still a subset of it, otherwise the candidate is tested again in
+ * a later round. The first answer of each round is always merged, so every round progresses.
+ * */
+void AssumMinimiser::parallelDel(vec<Lit> &result) {
+    vec<Lit>        vecAssum;
+    vec<Lit>        cands;
+    vec<vec<Lit> >  workerAssums;
+    vec<lbool>      rets;
+    int             i = 0;
+    result.clear(false);
+
+    if (isSatWithAssum() == l_True) return;
+
+    state.init(initAssum, s.nVars());
+    keepConflict(initConflict);
+
+    SolverPool workers(s, nThreads);
+    pool = &workers;
+    while (true) {
+        /* skipping the assumptions that are already determined */
+        while (i < initAssum.size() && state[initAssum[i]] != l_Undef) i++;
+        if (i == initAssum.size()) break;
+
+        cands.clear();
+        for (int j = i; j < initAssum.size() && cands.size() < workers.size(); ++j)
+            if (state[initAssum[j]] == l_Undef) cands.push(initAssum[j]);
+
+        vecAssum.clear();
+        stateToVec(vecAssum);
+        workerAssums.clear();
+        workerAssums.growTo(cands.size());
+        foreach(k, cands.size())
+            foreach(j, vecAssum.size())
+                if (vecAssum[j] != cands[k]) workerAssums[k].push(vecAssum[j]);
+
+        solveWorkers(workers, workerAssums, rets);
+
+        foreach(k, cands.size()) {
+            if (rets[k] == l_Undef) {
+                pool = NULL;
+                throw InterruptedException();
+            }
+            if (rets[k] == l_True) nSAT++; else nUNSAT++;
+            if (rets[k] == l_False) noteConflict(workers[k].conflict);
+            /* removed by the conflict of an earlier worker */
+            if (state[cands[k]] == l_False) continue;
+
+            if (rets[k] == l_True) {
+                TRACE(cands[k].toString() << " is essential");
+                state.set(cands[k], l_True);
+            } else if (isConflictInWorkingSet(workers[k].conflict)) {
+                TRACE(cands[k].toString() << " isn't essential" << std::endl
+                        << "Updating current assumptions");
+                keepConflict(workers[k].conflict);
+            } else {
+                TRACE("Conflict of " << cands[k].toString() << " is out of date");
+            }
+        }
+    }
+    pool = NULL;
+    stateToVec(result);
+    return;
+}
+
+bool AssumMinimiser::isConflictInWorkingSet(const vec<Lit>& conflict) {
+    foreach(i, conflict.size())
+        if (state[~conflict[i]] == l_False) return false;
+    return true;
+}
 
 void AssumMinimiser::rotationAlg(vec<Lit> &result) {
     lbool ret;
@@ -471,71 +1064,325 @@ void AssumMinimiser::rotationAlg(vec<Lit> &result) {
 
     if (isSatWithAssum() == l_True) return;
 
-    INIT_ASSUM_BITMAP(litBitMap);
+    state.init(initAssum, s.nVars());
+    keepConflict(initConflict);
+    retireRemoved();
 
     foreach(i, initAssum.size()) {
-        if(litBitMap[initAssum[i]] != l_Undef) continue;
-        litBitMap[initAssum[i]] = l_False;
+        if(state[initAssum[i]] != l_Undef) continue;
+        state.set(initAssum[i], l_False);
 
         TRACE("Removing " << initAssum[i].toString() << " from currAssum");
         // TODO: Maybe it would be more efficient to send in ~initAssum[i]?
-        litBitMapToVec(vecAssum);
-        vecAssum.push(~initAssum[i]);
+        stateToVec(vecAssum);
+        /* the negation of a group isn't an assumption, and groups aren't rotated */
+        bool group = groups != NULL && groups->isGroup(initAssum[i]);
+        if (!group) vecAssum.push(~initAssum[i]);
         ret = solveWithAssum(vecAssum);
         if (ret == l_True) {
         	TRACE(initAssum[i].toString() << " is vital");
         	TRACE("Added it back to currAssum");
-            litBitMap[initAssum[i]] = l_True;
+            state.set(initAssum[i], l_True);
             newVitalAssums.clear();
-        	if (recursiveTryToRotate(this->s.model, initAssum[i], newVitalAssums, rotDepth))
+            if (!group) s.loadModel(this->s.model);
+        	if (!group && recursiveTryToRotate(this->s.model, initAssum[i], newVitalAssums, rotDepth))
         	{
         		foreach(j, newVitalAssums.size()) {
         			TRACE("Marking as vital: " << newVitalAssums[j].toString());
-        		    litBitMap[newVitalAssums[j]] = l_True;
+        		    state.set(newVitalAssums[j], l_True);
         		}
         	}
+        	/* only now, the rotation checks the models against the clauses */
+        	hardenCritical(initAssum[i]);
+        	foreach(j, newVitalAssums.size()) hardenCritical(newVitalAssums[j]);
         } else {
         	TRACE(initAssum[i].toString() << " isn't essential" << std::endl
         			<< "Updating current assumptions");
         	TRACE("MiniSAT conflict minimization resulted with this: " << s.conflict.toString());
-        	vecToLitBitMap(s.conflict);
+        	keepConflict(s.conflict);
+        	retireRemoved();
         }
         vecAssum.clear(true);
     }
-    litBitMapToVec(result);
+    stateToVec(result);
     TRACE_END_FUNC;
     return;
 }
 
 
 void AssumMinimiser::iterativeIns(vec<Lit> &result) {
-	lbool res;
-	vec<Lit> tmp;
-	Lit *lit;
-    if (isSatWithAssum() == l_True) return;
-    result.clear(true);
-    INIT_ASSUM_BITMAP(litBitMap);
-
-    while (solveWithAssum(result) == l_True)
-    {
-    	tmp.copyFrom(result);
-    	MAP_FOREACH(lit, litBitMap)
-    	{
-    		tmp.push(*lit);
-    		if (solveWithAssum(result) == l_False)
-    		{
-    			litBitMap.remove(*lit);
-    			result.push(*lit);
-    			break;
-    		}
-    	}
-    }
+	vec<Lit> cands, tmp, hiConflict;
+	int      lo, hi, step, mid;
+	bool     hiKnown;
+	result.clear(true);
+	if (isSatWithAssum() == l_True) return;
+
+	state.init(initAssum, s.nVars());
+	initAssum.copyTo(cands);
+	filterByConflict(cands, initConflict);
+
+	/* INVARIANT: result + cands is UNSAT */
+	while (cands.size() > 0)
+	{
+		/* lo - length of the longest prefix of cands known to be SAT with result
+		 * hi - length of the shortest prefix of cands known to be UNSAT with result */
+		result.copyTo(tmp);
+		if (solveWithAssum(tmp) != l_True) break;
+		lo = result.size() > 0 ? skipSatisfiedCands(cands, 0) : 0;
+		hi = cands.size();
+		hiKnown = false;
+
+		/* exponential progression: adding 1, 2, 4, ... candidates */
+		for (step = 1; lo + step < hi; step *= 2)
+		{
+			prefixWithResult(result, cands, lo + step, tmp);
+			if (solveWithAssum(tmp) == l_True) {
+				lo = skipSatisfiedCands(cands, lo + step);
+			} else {
+				hi = lo + step;
+				s.conflict.copyTo(hiConflict);
+				hiKnown = true;
+				break;
+			}
+		}
+		/* binary search for the transition candidate */
+		while (hi - lo > 1)
+		{
+			mid = lo + (hi - lo) / 2;
+			prefixWithResult(result, cands, mid, tmp);
+			if (solveWithAssum(tmp) == l_True) {
+				lo = skipSatisfiedCands(cands, mid);
+			} else {
+				hi = mid;
+				s.conflict.copyTo(hiConflict);
+				hiKnown = true;
+			}
+		}
+		assert(hi == lo + 1);
+		TRACE(cands[lo].toString() << " is essential");
+		result.push(cands[lo]);
+		cands.shrink(cands.size() - lo);
+		if (hiKnown) filterByConflict(cands, hiConflict);
+	}
 	return;
 }
 
-void flipVarInModel(vec<lbool>& model, int var)
+void AssumMinimiser::prefixWithResult(const vec<Lit>& result, const vec<Lit>& cands,
+                                      int len, vec<Lit>& out)
+{
+	result.copyTo(out);
+	foreach(i, len) out.push(cands[i]);
+}
+
+/* the last call was SAT with the first 'from' candidates, so the prefix can be
+ * extended as long as the candidates are satisfied by the model */
+int AssumMinimiser::skipSatisfiedCands(const vec<Lit>& cands, int from)
+{
+	while (from < cands.size() && assumSatisfied(cands[from])) from++;
+	return from;
+}
+
+/*
+ * Parameters:
+ *    * bg     - assumptions that are kept in every call made by this step.
+ *    * testBg - if set, bg alone is checked first. Unset when bg is known to be SAT.
+ *    * cands  - candidates, bg+cands must be UNSAT.
+ *    * out    - output: a minimal subset of cands that is UNSAT together with bg.
+ *               Empty iff bg alone is UNSAT, s.conflict then holds bg's conflict.
+ * */
+void AssumMinimiser::quickXplainRec(vec<Lit>& bg, bool testBg, vec<Lit>& cands, vec<Lit>& out)
 {
-	model[var] = ~model[var];
+	vec<Lit> c1, c2, d1, d2, bg1, bg2;
+	out.clear();
+	if (testBg && solveWithAssum(bg) != l_True) return;
+	if (cands.size() == 1)
+	{
+		out.push(cands[0]);
+		return;
+	}
+	assert(cands.size() > 1);
+	foreach(i, cands.size()) (i < cands.size()/2 ? c1 : c2).push(cands[i]);
+
+	bg.copyTo(bg1);
+	foreach(i, c1.size()) bg1.push(c1[i]);
+	quickXplainRec(bg1, true, c2, d2);
+	if (d2.size() == 0)
+	{
+		/* bg+c1 was UNSAT and no other call was made since,
+		 * so only the part of c1 that is in the conflict is needed */
+		TRACE("Shrinking by conflict: " << s.conflict.toString());
+		filterByConflict(c1, s.conflict);
+	}
+
+	bg.copyTo(bg2);
+	foreach(i, d2.size()) bg2.push(d2[i]);
+	quickXplainRec(bg2, d2.size() > 0, c1, d1);
+
+	d1.copyTo(out);
+	foreach(i, d2.size()) out.push(d2[i]);
+}
+
+void AssumMinimiser::quickXplain(vec<Lit> &result) {
+	vec<Lit> bg, cands;
+	TRACE_START_FUNC;
+	result.clear(false);
+
+	if (isSatWithAssum() == l_True) return;
+
+	state.init(initAssum, s.nVars());
+	initAssum.copyTo(cands);
+	filterByConflict(cands, initConflict);
+	if (cands.size() > 0)
+		quickXplainRec(bg, false, cands, result);
+	TRACE_END_FUNC;
+}
+
+void AssumMinimiser::growToCorrectionSet(vec<char>& inSet, vec<int>& mcs) {
+	vec<Lit> sat;
+	foreach(i, initAssum.size()) if (inSet[i]) sat.push(initAssum[i]);
+	/* s has a model of sat, every assumption it satisfies is added for free */
+	foreach(i, initAssum.size())
+	{
+		if (inSet[i]) continue;
+		if (!assumSatisfied(initAssum[i]))
+		{
+			sat.push(initAssum[i]);
+			if (solveWithAssum(sat) == l_False)
+			{
+				sat.pop();
+				continue;
+			}
+		}
+		else
+			sat.push(initAssum[i]);
+		inSet[i] = 1;
+		for (int j = i + 1; j < initAssum.size(); ++j)
+			if (!inSet[j] && assumSatisfied(initAssum[j]))
+				sat.push(initAssum[j]), inSet[j] = 1;
+	}
+	mcs.clear();
+	foreach(i, initAssum.size()) if (!inSet[i]) mcs.push(i);
+}
+
+void AssumMinimiser::smallestMus(vec<Lit> &result) {
+	vec<Lit>   best, hs;
+	vec<int>   hsIdx, mcs;
+	vec<char>  inSet;
+	vec<int>   w;
+	int64_t    lb = 1;
+	const char *measure = weighted() ? "weight" : "size";
+	TRACE_START_FUNC;
+	result.clear(false);
+
+	if (isSatWithAssum() == l_True) return;
+
+	/* the upper bound starts from a minimal set. The hitting sets are checked on s
+	 * later, so the bound mustn't harden or retire any of the assumptions */
+	bool hardenWas = harden, retireWas = retire;
+	harden = retire = false;
+	iterativeDel2(best);
+	harden = hardenWas;
+	retire = retireWas;
+	if (best.size() == 0) return; /* UNSAT without the assumptions */
+	if (weighted())
+	{
+		/* every conflicting set weighs at least as much as the lightest assumption */
+		foreach(i, initAssum.size()) w.push(weightOf(initAssum[i]));
+		lb = w[0];
+		foreach(i, w.size()) if (w[i] < lb) lb = w[i];
+	}
+	printf("SMUS bounds: %"PRId64" <= %s <= %"PRId64"\n", lb, measure, weight(best));
+
+	MinHittingSet hitter(initAssum.size(), weighted() ? &w : NULL);
+	this->hitter = &hitter;
+	try {
+		while (lb < weight(best))
+		{
+			lbool ret = hitter.solve(lb, hsIdx);
+			if (ret == l_Undef) throw InterruptedException();
+			if (ret == l_False)
+			{
+				/* the weights of the sets are multiples of the step */
+				lb += hitter.step();
+				printf("SMUS bounds: %"PRId64" <= %s <= %"PRId64"\n", lb, measure, weight(best));
+				continue;
+			}
+			hs.clear();
+			foreach(i, hsIdx.size()) hs.push(initAssum[hsIdx[i]]);
+			if (solveWithAssum(hs) == l_False)
+			{
+				/* a minimum hitting set, no conflicting set is lighter */
+				hs.copyTo(best);
+				printf("SMUS bounds: %"PRId64" <= %s <= %"PRId64"\n", weight(best), measure, weight(best));
+				break;
+			}
+			inSet.clear();
+			inSet.growTo(initAssum.size(), 0);
+			foreach(i, hsIdx.size()) inSet[hsIdx[i]] = 1;
+			growToCorrectionSet(inSet, mcs);
+			hitter.addSet(mcs);
+		}
+	} catch (InterruptedException&) {
+		printf("SMUS interrupted, the result is minimal but it may not be the smallest\n");
+	}
+	this->hitter = NULL;
+	best.copyTo(result);
+	TRACE_END_FUNC;
+}
+
+void AssumMinimiser::necessaryAssums(vec<Lit> &result) {
+    vec<Lit>        cands;
+    vec<vec<Lit> >  workerAssums;
+    vec<lbool>      rets;
+    int             i = 0;
+    result.clear(false);
+
+    if (isSatWithAssum() == l_True) return;
+
+    /* an assumption that is out of a conflict isn't in the minimal sets inside it */
+    state.init(initAssum, s.nVars());
+    keepConflict(initConflict);
+
+    SolverPool workers(s, nThreads);
+    pool = &workers;
+    while (true) {
+        while (i < initAssum.size() && state[initAssum[i]] != l_Undef) i++;
+        if (i == initAssum.size()) break;
+
+        cands.clear();
+        for (int j = i; j < initAssum.size() && cands.size() < workers.size(); ++j)
+            if (state[initAssum[j]] == l_Undef) cands.push(initAssum[j]);
+
+        workerAssums.clear();
+        workerAssums.growTo(cands.size());
+        foreach(k, cands.size())
+            foreach(j, initAssum.size())
+                if (initAssum[j] != cands[k]) workerAssums[k].push(initAssum[j]);
+
+        solveWorkers(workers, workerAssums, rets);
+
+        foreach(k, cands.size()) {
+            if (rets[k] == l_Undef) {
+                pool = NULL;
+                throw InterruptedException();
+            }
+            if (rets[k] == l_True) {
+                nSAT++;
+                TRACE(cands[k].toString() << " is necessary");
+                state.set(cands[k], l_True);
+            } else {
+                nUNSAT++;
+                /* every conflict of a subset of initAssum stays valid, so all of the
+                 * candidates out of it are cleared, including the ones of this round */
+                TRACE(cands[k].toString() << " isn't necessary");
+                keepConflict(workers[k].conflict);
+            }
+        }
+    }
+    pool = NULL;
+    foreach(j, initAssum.size())
+        if (state[initAssum[j]] == l_True) result.push(initAssum[j]);
+    return;
 }
 
 /* l's potential literals are defined to be the literals that are common to all
@@ -544,8 +1391,12 @@ inline vec<Lit>* getPotentialLiterals(Lit lit, Solver& solver)
 {
 	vec<vec<Lit>*>  clausesContainingLit;
 
+	vec<Lit>        *res;
+
 	solver.getWeakClausesContaining(lit, clausesContainingLit);
-	return getMutualLiteralsInClauses(clausesContainingLit); //dynamic alloc
+	res = getMutualLiteralsInClauses(clausesContainingLit); //dynamic alloc
+	foreach(i, clausesContainingLit.size()) delete clausesContainingLit[i];
+	return res;
 }
 
 
@@ -554,6 +1405,7 @@ inline vec<Lit>* getPotentialLiterals(Lit lit, Solver& solver)
  * Parameters:
  *    * model - a vector of literals, defines an assignment to all of the variables
  *              the function does NOT guarantee to leave the model untouched.
+ *              It must be tracked by the solver (see Solver::loadModel).
  *    * vitalAssum - the vital assumption, it must NOT hold under the current given model
  *    * newVital - output:
  * */
@@ -575,7 +1427,7 @@ bool   AssumMinimiser::tryToRotate   (vec<lbool>& model, Lit vitalAssum, vec<Lit
 	pMutualLiterals = getPotentialLiterals(~vitalAssum, s); // dynamic alloc
 	/* original vital assumption must be flipped back
 	 * to the assignment in order to find new vitals */
-	/*flipOut*/flipVarInModel(model, var(vitalAssum));
+	/*flipOut*/s.flipModelVar(model, var(vitalAssum));
 
 	/* if there's only 1, then it's the original ~vitalAssum
 	 * if there's none then there are no clauses containing ~vitalAssum*/
@@ -599,11 +1451,11 @@ bool   AssumMinimiser::tryToRotate   (vec<lbool>& model, Lit vitalAssum, vec<Lit
 		if (isConfWithAssum(l))    // l is a potential newVital
 		{
 			/* we don't want to try an already determined assum */
-			if (litBitMap[~l] != l_Undef) continue;
+			if (state[~l] != l_Undef) continue;
 			/* flipping the new potential vital assumption out of the model*/
-			/*flipOut*/flipVarInModel(model, var(l));
+			/*flipOut*/s.flipModelVar(model, var(l));
 			TRACE("Found a potential vital: " << l.toString());
-			if (s.checkIfModel(model))
+			if (s.isModel())
 			{
 				/* remember that l is conflicting with
 				 * the assumptions, so ~l is an assumption */
@@ -621,7 +1473,7 @@ bool   AssumMinimiser::tryToRotate   (vec<lbool>& model, Lit vitalAssum, vec<Lit
 			pBrokerMutualLiterals = getPotentialLiterals(~l, s); //dynamic alloc
 			TRACE("Mutual Literals are: " << pBrokerMutualLiterals->toString());
 			/* flipping the new potential broker out of the model*/
-			/*flipOut*/flipVarInModel(model, var(l));
+			/*flipOut*/s.flipModelVar(model, var(l));
 			if (pBrokerMutualLiterals->size() > 1)
 			{
 				TRACE("Broker " << l.toString()
@@ -636,27 +1488,27 @@ bool   AssumMinimiser::tryToRotate   (vec<lbool>& model, Lit vitalAssum, vec<Lit
 					{
 						TRACE("Under broker: " << l.toString() <<
 								"Found a potential vital: " << k.toString());
-						/*flipOut*/flipVarInModel(model, var(k));
-						if (s.checkIfModel(model))
+						/*flipOut*/s.flipModelVar(model, var(k));
+						if (s.isModel())
 						{
 							newVitals.push(~k);
 							res = true;
-							litBitMap[~k] = l_True;
+							state.set(~k, l_True);
 							//delete pBrokerMutualLiterals;
 							//goto CLEANUP;
 						}
-						/*flipIn*/flipVarInModel(model, var(k));
+						/*flipIn*/s.flipModelVar(model, var(k));
 					}
 				}
 			}
 			assert(pBrokerMutualLiterals->size() >= 1);
 			delete pBrokerMutualLiterals;
 		}
-		/*flipIn*/flipVarInModel(model, var(l));
+		/*flipIn*/s.flipModelVar(model, var(l));
 	}
 
 CLEANUP:
-/*flipIn*/flipVarInModel(model, var(vitalAssum));
+/*flipIn*/s.flipModelVar(model, var(vitalAssum));
     delete pMutualLiterals;
     if (res) { TRACE("FOUND VITAL ASSUMPTION(S): " << newVitals.toString()); }
     else     { TRACE("NO NEW VITAL FOUND");                              }
@@ -664,68 +1516,133 @@ CLEANUP:
     return res;
 }
 
+/*
+ * Explores the literals reachable from pivot through potential literals, depth first
+ * with an explicit stack. Every literal on the stack is flipped in the model, so a
+ * conflicting literal found on the way is a new vital if flipping it gives a model,
+ * these are tested in batches when the literal is pushed.
+ * Each variable is visited at most once per call (i.e. once per model), so every
+ * literal's potential literals are computed once and cached in its marking slot.
+ * */
 bool AssumMinimiser::recursiveTryToRotate (
 		vec<lbool>& model,
 		Lit pivot,
 		vec<Lit>& newVitals,
-		int recursionDepth)
+		int maxDepth)
 {
 	// Local variables
-	Stack<Lit>      stack(recursionDepth);     // this stack is used to make the recursion
-	vec<vec<Lit>*>  clausesContainingVitAssum;
-	vec<Lit>        *pMutualLiterals            = NULL;
-	bool            res                         = false;
-	Lit             l                           = lit_Undef;
+	vec<RotationFrame> stack;
+	vec<Lit>           visited;
+	bool               res = false;
+	Lit                l   = lit_Undef;
 
-	//stack.push(assum);
 	TRACE_START_FUNC;
 
-	markLit(pivot);
-	pMutualLiterals = getPotentialLiterals(~pivot, s); // dynamic alloc
 	TRACE("Pivot is: " << pivot.toString());
-	/*flipOut*/flipVarInModel(model, var(pivot));
-	foreach(iL, pMutualLiterals->size())
+	markLit(pivot);
+	visited.push(pivot);
+	/*flipOut*/s.flipModelVar(model, var(pivot));
+	stack.push(RotationFrame(pivot));
+	res = testPotentialVitals(model, stack.last(), newVitals);
+	while (stack.size() > 0)
 	{
-		l = (*pMutualLiterals)[iL];
+		RotationFrame& frame = stack.last();
+		const vec<Lit>& mutualLiterals = potentialLiterals(frame.lit);
+		if (frame.next == mutualLiterals.size())
+		{
+			/*flipIn*/s.flipModelVar(model, var(frame.lit));
+			stack.pop();
+			continue;
+		}
+		l = mutualLiterals[frame.next++];
 		TRACE("Found mutual lit: " << l.toString());
 
-		if (isVarMarked(var(l))) /* we don't want to visit variable
-		                         * that's already in the recursion stack */
+		if (isVarMarked(var(l))) /* we don't want to visit a variable twice */
 			continue;
 
-		if (isConfWithAssum(l))    // l is a potential newVital
+		/* we don't want to go through an assumption that was determined
+		 * before it was tested along with frame's potential vitals */
+		if (isConfWithAssum(l) && state[~l] != l_Undef)
 		{
-			/* we don't want to try an already determined assum */
-			if (litBitMap[~l] != l_Undef) continue; // TODO: identify already visited literals, not just assumptions
+			bool foundInFrame = false;
+			for (int j = frame.vitalsBegin; j < frame.vitalsEnd; ++j)
+				if (newVitals[j] == ~l) foundInFrame = true;
+			if (!foundInFrame) continue;
+		}
 
-			/*flipOut*/flipVarInModel(model, var(l));
+		markLit(l);
+		visited.push(l);
+		if (stack.size() < maxDepth)
+		{
+			/*flipOut*/s.flipModelVar(model, var(l));
+			stack.push(RotationFrame(l));
+			res = testPotentialVitals(model, stack.last(), newVitals) || res;
+		}
+	}
 
-			TRACE("Found a potential vital: " << (~l).toString());
-			if (s.checkIfModel(model))
-			{
-				/* remember that l is conflicting with
-				 * the assumptions, so ~l is an assumption */
-				newVitals.push(~l);
-				litBitMap[~l] = l_True;
-				res = true;
-			}
-			/*flipIn*/flipVarInModel(model, var(l));
+	/* unmarking in reverse order, as the marking slots are a stack */
+	for (int i = visited.size() - 1; i >= 0; --i) unmarkLit(visited[i]);
+	TRACE_END_FUNC;
+	return res;
+}
 
-		}
+/*
+ * Tests the potential vitals among the potential literals of frame.lit under the
+ * current model at once, each potential vital is flipped in its own lane.
+ * */
+bool AssumMinimiser::testPotentialVitals(vec<lbool>& model, RotationFrame& frame, vec<Lit>& newVitals)
+{
+	const vec<Lit>& mutualLiterals = potentialLiterals(frame.lit);
+	vec<Lit>        cands;
+	vec<Var>        flips;
+	vec<uint64_t>   lanes;
+	uint64_t        models;
+	bool            res = false;
+
+	foreach(i, mutualLiterals.size())
+	{
+		Lit l = mutualLiterals[i];
+		/* we don't want to try an already determined assum */
+		if (isVarMarked(var(l)) || !isConfWithAssum(l) || state[~l] != l_Undef) continue;
+		TRACE("Found a potential vital: " << (~l).toString());
+		cands.push(l);
+	}
 
-		/* TODO: recursion can be flattened out
-		 * by using a stack and computing every literal's
-		 * "potential literals" just once! */
-		res = res ||
-				recursiveTryToRotate(model, l, newVitals, recursionDepth-1);
+	frame.vitalsBegin = newVitals.size();
+	for (int first = 0; first < cands.size(); first += 64)
+	{
+		flips.clear();
+		lanes.clear();
+		for (int i = first; i < cands.size() && i < first + 64; ++i)
+		{
+			flips.push(var(cands[i]));
+			lanes.push((uint64_t)1 << (i - first));
+		}
+		models = s.checkIfModelsInc(model, flips, lanes);
+		foreach(i, flips.size())
+		{
+			if (!((models >> i) & 1)) continue;
+			/* remember that l is conflicting with
+			 * the assumptions, so ~l is an assumption */
+			newVitals.push(~cands[first + i]);
+			state.set(~cands[first + i], l_True);
+			res = true;
+		}
 	}
-	/*flipIn*/flipVarInModel(model, var(pivot));
-	unmarkLit(pivot);
-	delete pMutualLiterals;
-	TRACE_END_FUNC;
+	frame.vitalsEnd = newVitals.size();
 	return res;
 }
 
+const vec<Lit>& AssumMinimiser::potentialLiterals(Lit l)
+{
+	Var v = var(l);
+	assert (isLitMarked(l));
+	vec<Lit>*& slot = sign(l) ? negVarClauses[vars[v].index] : posVarClauses[vars[v].index];
+	if (slot == NULL)
+		slot = getPotentialLiterals(~l, s); // dynamic alloc, freed by unmarkLit
+	return *slot;
+}
+
 void AssumMinimiser::markLit(Lit l)
 {
 	Var v = var(l);
@@ -775,6 +1692,124 @@ void AssumMinimiser::unmarkLit(Lit l)
 
 
 
+void AssumMinimiser::minimise(int alg, vec<Lit> &result)
+{
+	switch (alg)
+	{
+	case 1: iterativeDel (result); break;
+	case 2: iterativeDel2(result); break;
+	case 3: iterativeIns (result); break;
+	case 4: rotationAlg  (result); break;
+	case 5: quickXplain  (result); break;
+	case 6: chunkedDel   (result); break;
+	case 7: parallelDel  (result); break;
+	case 8: smallestMus  (result); break;
+	case 9: necessaryAssums(result); break;
+	default:
+		printf("Internal error!\n");
+		exit(1);
+	}
+}
+
+const char* AssumMinimiser::algName(int alg)
+{
+	switch (alg)
+	{
+	case 1:  return "Iterative Deletion Algorithm";
+	case 2:  return "Iterative Deletion Algorithm with MiniSAT's minimizer";
+	case 3:  return "Iterative Insertion Algorithm with progression";
+	case 4:  return "Rotation Algorithm";
+	case 5:  return "QuickXplain Algorithm";
+	case 6:  return "Chunked Deletion Algorithm";
+	case 7:  return "Parallel Iterative Deletion Algorithm";
+	case 8:  return "Smallest Conflicting Set Algorithm (hitting sets)";
+	case 9:  return "Necessary Assumptions Algorithm (intersection of the minimal sets)";
+	default: return NULL;
+	}
+}
+
+int AssumMinimiser::trimCore(int maxRounds, double seed)
+{
+	vec<Lit> core;
+	int      rounds = 0;
+	if (isSatWithAssum() == l_True) return 0;
+
+	while (rounds < maxRounds && initConflict.size() > 0)
+	{
+		core.clear();
+		foreach(i, initConflict.size()) core.push(~initConflict[i]);
+		/* analyzeFinal depends on the order of the assumptions */
+		for (int i = core.size() - 1; i > 0; --i)
+		{
+			int j = Solver::irand(seed, i + 1);
+			Lit t = core[i]; core[i] = core[j]; core[j] = t;
+		}
+		rounds++;
+		if (solveWithAssum(core) == l_True)
+		{
+			printf("Internal error! A conflict is SAT\n");
+			exit(1);
+		}
+		TRACE("Trimming round " << rounds << ": " << initConflict.size() << " -> " << s.conflict.size());
+		if (s.conflict.size() >= initConflict.size()) break;
+		s.conflict.copyTo(initConflict);
+	}
+	return rounds;
+}
+
+int AssumMinimiser::orderByName(const char* name)
+{
+	if (strcmp(name, "file")       == 0) return OrderFile;
+	if (strcmp(name, "activity")   == 0) return OrderActivity;
+	if (strcmp(name, "occurrence") == 0) return OrderOccurrence;
+	if (strcmp(name, "conflict")   == 0) return OrderConflict;
+	if (strcmp(name, "random")     == 0) return OrderRandom;
+	if (strcmp(name, "weight")     == 0) return OrderWeight;
+	return -1;
+}
+
+/*
+ * activity   - the least active assumptions first, the active ones tend to be in the conflicts.
+ * occurrence - the assumptions whose variable occurs in the fewest original clauses first.
+ * conflict   - the assumptions out of the initial conflict first (they are dropped at once),
+ *              then in the order of the conflict.
+ * weight     - the heaviest assumptions first, so the minimal set tends to be a light one.
+ * */
+void AssumMinimiser::orderAssumptions(int order, double seed)
+{
+	vec<double> keys;
+	vec<int>    idx;
+	vec<Lit>    ordered;
+	assert(isSatWith != l_Undef);
+
+	foreach(i, initAssum.size())
+	{
+		Lit a = initAssum[i];
+		idx.push(i);
+		switch (order)
+		{
+		case OrderActivity:   keys.push(s.varActivity(var(a))); break;
+		case OrderOccurrence: keys.push(s.nClausesContaining(a) + s.nClausesContaining(~a)); break;
+		case OrderConflict:   keys.push(-1); break; /* set below */
+		case OrderRandom:     keys.push(Solver::drand(seed)); break;
+		case OrderWeight:     keys.push(-weightOf(a)); break;
+		default:              keys.push(i); break;
+		}
+	}
+	if (order == OrderConflict)
+	{
+		Map<Lit, int, LitHash> pos;
+		int                    p;
+		foreach(i, initConflict.size()) pos.insert(~initConflict[i], i);
+		foreach(i, initAssum.size())
+			if (pos.peek(initAssum[i], p)) keys[i] = p;
+	}
+	sort(idx, IndexKeyLt(keys));
+	foreach(i, idx.size()) ordered.push(initAssum[idx[i]]);
+	ordered.copyTo(initAssum);
+	TRACE("Ordered assums are: " << initAssum.toString());
+}
+
 void AssumMinimiser::printCurrentStats()
 {
 	uint64_t starts = s.starts,
@@ -0,0 +1,123 @@
+/*
+ * ClauseExchange.h
+ *
+ *  Lock-free exchange of short learnt clauses between solvers that work on the same
+ *  problem in parallel. Every solver writes to its own ring buffer and reads the rings
+ *  of the others, a reader that falls behind a ring by more than its capacity skips
+ *  the clauses that were overwritten. A reader may copy a slot while it's overwritten,
+ *  so the words of the slots are atomic (relaxed), the sequence number tells whether
+ *  the copy is consistent.
+ */
+
+#ifndef MCA_CLAUSEEXCHANGE_H_
+#define MCA_CLAUSEEXCHANGE_H_
+
+#include <stdint.h>
+
+#include "mtl/Vec.h"
+#include "mca/SolverTypes.h"
+#include "mca/global_defs.h"
+
+namespace Minisat {
+
+class ClauseExchange {
+public:
+	enum { MaxLen = 32, Capacity = 4096 };
+
+private:
+	/* seq is 2k+1 while the k'th clause of the ring is written to the slot, 2k+2 when it's done.
+	 * the literals are kept by toInt() */
+	struct Slot
+	{
+		uint64_t  seq;
+		int       size;
+		int       lits[MaxLen];
+	};
+	struct Ring
+	{
+		Slot      slots[Capacity];
+		uint64_t  head;         // number of clauses written to the ring
+	};
+
+	vec<Ring*>      rings;
+	vec<uint64_t>   cursors;    // cursors[reader * nSolvers() + writer] is the next clause to read
+	vec<int>        nextRing;   // the ring each reader reads next
+
+public:
+	ClauseExchange(int nSolvers)
+	{
+		foreach(i, nSolvers)
+		{
+			rings.push(new Ring);
+			rings.last()->head = 0;
+			foreach(j, Capacity) rings.last()->slots[j].seq = 0;
+		}
+		cursors.growTo(nSolvers * nSolvers, 0);
+		nextRing.growTo(nSolvers, 0);
+	}
+	~ClauseExchange()
+	{
+		foreach(i, rings.size()) delete rings[i];
+	}
+
+	int      nSolvers  () const       { return rings.size(); }
+
+	/* called only by solver 'id', c.size() must be at most MaxLen */
+	void     exportClause(int id, const vec<Lit>& c);
+	/* reads the next clause exported by another solver, returns false if there is none */
+	bool     importClause(int id, vec<Lit>& out);
+};
+
+inline void ClauseExchange::exportClause(int id, const vec<Lit>& c)
+{
+	assert(c.size() <= MaxLen);
+	Ring&    ring = *rings[id];
+	uint64_t k    = ring.head;
+	Slot&    slot = ring.slots[k % Capacity];
+
+	__atomic_store_n(&slot.seq, 2*k + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&slot.size, c.size(), __ATOMIC_RELAXED);
+	foreach(i, c.size()) __atomic_store_n(&slot.lits[i], toInt(c[i]), __ATOMIC_RELAXED);
+	__atomic_store_n(&slot.seq, 2*k + 2, __ATOMIC_RELEASE);
+	__atomic_store_n(&ring.head, k + 1, __ATOMIC_RELEASE);
+}
+
+inline bool ClauseExchange::importClause(int id, vec<Lit>& out)
+{
+	foreach(n, nSolvers())
+	{
+		int       w      = nextRing[id];
+		Ring&     ring   = *rings[w];
+		uint64_t& cursor = cursors[id * nSolvers() + w];
+		uint64_t  head   = __atomic_load_n(&ring.head, __ATOMIC_ACQUIRE);
+
+		if (w == id || cursor == head)
+		{
+			nextRing[id] = (w + 1) % nSolvers();
+			continue;
+		}
+		if (head - cursor > Capacity) cursor = head - Capacity;
+
+		Slot&    slot = ring.slots[cursor % Capacity];
+		uint64_t seq  = __atomic_load_n(&slot.seq, __ATOMIC_ACQUIRE);
+		bool     ok   = seq == 2*cursor + 2;
+		if (ok)
+		{
+			/* every size that is written is at most MaxLen, even a torn copy can't overflow */
+			int size = __atomic_load_n(&slot.size, __ATOMIC_RELAXED);
+			out.clear();
+			foreach(i, size) out.push(toLit(__atomic_load_n(&slot.lits[i], __ATOMIC_RELAXED)));
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			/* the writer may have lapped us while copying */
+			ok = __atomic_load_n(&slot.seq, __ATOMIC_RELAXED) == seq;
+		}
+		cursor++;
+		if (ok) return true;
+	}
+	return false;
+}
+
+}
+
+#endif /* MCA_CLAUSEEXCHANGE_H_ */
@@ -44,8 +44,11 @@ static void readClause(B& in, Solver& S, vec<Lit>& lits) {
     }
 }
 
+// If 'selectors' is given, every clause is guarded by a new selector variable, as mca_test/pp.sh
+// does: clause i (from 1) gets the literal -(vars+i), and the selector of clause i is pushed
+// as the i-th (positive) assumption.
 template<class B, class Solver>
-static void parse_DIMACS_main(B& in, Solver& S) {
+static void parse_DIMACS_main(B& in, Solver& S, vec<Lit>* selectors = NULL) {
     vec<Lit> lits;
     int vars    = 0;
     int clauses = 0;
@@ -57,6 +60,10 @@ static void parse_DIMACS_main(B& in, Solver& S) {
             if (eagerMatch(in, "p cnf")) {
                 vars    = parseInt(in);
                 clauses = parseInt(in);
+                if (selectors != NULL){
+                    if (cnt > 0)
+                        printf("PARSE ERROR! The header must come before the clauses\n"), exit(3);
+                    while (S.nVars() < vars) S.newVar(); }
                 // SATRACE'06 hack
                 // if (clauses > 4000000)
                 //     S.eliminate(true);
@@ -68,25 +75,53 @@ static void parse_DIMACS_main(B& in, Solver& S) {
         else {
             cnt++;
             readClause(in, S, lits);
+            if (selectors != NULL){
+                for (int i = 0; i < lits.size(); i++)
+                    if (var(lits[i]) >= vars)
+                        printf("PARSE ERROR! Clause %d has a variable out of the header's range: %d\n", cnt, var(lits[i])+1), exit(3);
+                Var sel = S.newVar();
+                lits.push(~mkLit(sel));
+                selectors->push(mkLit(sel)); }
             S.addClause_(lits);
         }
     }
-    if (vars != S.nVars())
+    if (vars + (selectors != NULL ? cnt : 0) != S.nVars())
         fprintf(stderr, "WARNING! DIMACS header mismatch: wrong number of variables.\n");
     if (cnt  != clauses)
         fprintf(stderr, "WARNING! DIMACS header mismatch: wrong number of clauses.\n");
 }
 
+// Reads the assumptions, one literal each, or a group of literals that are added and removed as
+// one unit: "g <lit> ... <lit> 0". The first literal of a group is pushed to the assumptions
+// and the whole group to groups. The header counts a group as one assumption.
+// An assumption or a group may be preceded by its weight, "w <weight>", the default is 1.
+// weights[i] is the weight of assumptions[i].
 //template<class Solver>
 static void parse_DIMACS_assumptions(gzFile input_stream,
 		int nVars,
-		vec<Lit> &assumptions) {
+		vec<Lit> &assumptions,
+		vec<vec<Lit> > &groups,
+		vec<int> &weights) {
 	StreamBuffer in(input_stream);
     int parsed_lit, var;
 	int nAssumptions = 0, expectedAssumptions = 0;
+	int weight = 0;            // the weight of the next assumption, 0 if it wasn't given
+	vec<char> used(nVars, 0);  // 1 - a single assumption, 2 - in a group
 	for (;;) {
 		skipWhitespace(in);
 		if (*in == EOF) break;
+		else if (*in == 'w')
+		{
+			++in;
+			if (weight != 0) {
+				printf("Illegal Assumptions file. Two weights for one assumption"), exit(3);
+			}
+			weight = parseInt(in);
+			if (weight <= 0) {
+				printf("Illegal Assumptions file. The weights must be positive: %d", weight), exit(3);
+			}
+			continue;
+		}
 		else if (*in == 'p')
 		{
 			if (eagerMatch(in, "p assumptions")) {
@@ -99,16 +134,49 @@ static void parse_DIMACS_assumptions(gzFile input_stream,
 		else if (*in == 'c' || *in == 'p') {
 			skipLine(in);
 		}
+		else if (*in == 'g') {
+			++in;
+			groups.push();
+			for (;;) {
+				parsed_lit = parseInt(in);
+				if (parsed_lit == 0) break;
+				var = abs(parsed_lit)-1;
+				if (var >= nVars) {
+					printf("Illegal Assumptions file. Unexpected literal: %d", parsed_lit), exit(3);
+				}
+				if (used[var]) {
+					printf("Illegal Assumptions file. A group shares a variable with another assumption: %d", parsed_lit), exit(3);
+				}
+				used[var] = 2;
+				groups.last().push((parsed_lit > 0) ? mkLit(var) : ~mkLit(var));
+			}
+			if (groups.last().size() == 0) {
+				printf("Illegal Assumptions file. Empty group"), exit(3);
+			}
+			assumptions.push(groups.last()[0]);
+			weights.push(weight != 0 ? weight : 1);
+			weight = 0;
+			nAssumptions++;
+		}
 		else {
 			parsed_lit = parseInt(in);
 			var = abs(parsed_lit)-1;
 			if (parsed_lit == 0 || var >= nVars) {
 				printf("Illegal Assumptions file. Unexpected literal: %d", parsed_lit), exit(3);
 			}
+			if (used[var] == 2) {
+				printf("Illegal Assumptions file. A group shares a variable with another assumption: %d", parsed_lit), exit(3);
+			}
+			used[var] = 1;
 			assumptions.push((parsed_lit > 0) ? mkLit(var) : ~mkLit(var));
+			weights.push(weight != 0 ? weight : 1);
+			weight = 0;
 			nAssumptions++;
 		}
 	}
+	if (weight != 0) {
+		printf("Illegal Assumptions file. A weight without an assumption"), exit(3);
+	}
 	if (nAssumptions != expectedAssumptions) {
         fprintf(stderr, "|       WARNING! DIMACS header mismatch: wrong number of assumptions.        |\n");
 	}
@@ -118,6 +186,32 @@ static void parse_DIMACS_assumptions(gzFile input_stream,
 }
 
 
+// Reads the sets of a previous enumeration (see MusEnumerator), one set per line
+// terminated by 0, every other line is skipped.
+static void parse_MCA_sets(gzFile input_stream,
+		int nVars,
+		vec<vec<Lit> > &sets) {
+	StreamBuffer in(input_stream);
+	int parsed_lit, var;
+	for (;;) {
+		skipWhitespace(in);
+		if (*in == EOF) break;
+		else if (*in != '-' && (*in < '0' || *in > '9')) {
+			skipLine(in);
+			continue;
+		}
+		sets.push();
+		for (;;) {
+			parsed_lit = parseInt(in);
+			if (parsed_lit == 0) break;
+			var = abs(parsed_lit)-1;
+			if (var >= nVars) {
+				printf("Illegal sets file. Unexpected literal: %d", parsed_lit), exit(3);
+			}
+			sets.last().push((parsed_lit > 0) ? mkLit(var) : ~mkLit(var));
+		}
+	}
+}
 
 // Inserts problem into solver.
 //
@@ -126,6 +220,13 @@ static void parse_DIMACS(gzFile input_stream, Solver& S) {
     StreamBuffer in(input_stream);
     parse_DIMACS_main(in, S); }
 
+// Inserts problem into solver, with a selector for each clause (see parse_DIMACS_main).
+//
+template<class Solver>
+static void parse_DIMACS(gzFile input_stream, Solver& S, vec<Lit>& selectors) {
+    StreamBuffer in(input_stream);
+    parse_DIMACS_main(in, S, &selectors); }
+
 //=================================================================================================
 }
 
@@ -0,0 +1,152 @@
+/*
+ * HittingSet.h
+ *
+ *  Minimum hitting sets of a growing collection of sets of indices 0..n-1, on a
+ *  second Solver. Variable i stands for index i, and a sequential counter over
+ *  them bounds the size of the hitting set through an assumption, so raising the
+ *  bound keeps everything the solver learnt. The counter only counts up to its
+ *  width, the solver is rebuilt with a wider counter when the bound outgrows it.
+ *  With weights, the size is the total weight of the chosen indices: index i
+ *  moves the counter up by its weight, so the width grows with the bound. The
+ *  weights are counted in units of their gcd, and at most MaxWeight units each.
+ */
+
+#ifndef MCA_HITTINGSET_H_
+#define MCA_HITTINGSET_H_
+
+#include "mca/Solver.h"
+#include "mca/global_defs.h"
+
+namespace Minisat {
+
+static int gcd(int a, int b) { while (b != 0) { int t = a % b; a = b; b = t; } return a; }
+
+class MinHittingSet {
+	int              n;
+	vec<int>         weight;    // in units of their gcd, every weight is 1 if there are none
+	int              unit;      // the gcd of the weights
+	int              total;     // the weight of all of the indices, in units
+	int              width;     // the counter counts up to width
+	Solver          *S;
+	vec<vec<int> >   sets;
+	vec<Var>         atLeast;   // atLeast[j] is implied when more than j of the indices are chosen
+	bool             interrupted;
+
+	void     build     (int w);
+
+public:
+	/* the largest weight in units of the gcd. The counter needs a variable for each index
+	 * and unit of the bound, so this keeps it at most MaxWeight times as large as without
+	 * weights (an encoding that doesn't grow with the weights isn't worth it here) */
+	enum { MaxWeight = 100 };
+	static int maxUnits (const vec<int>& weights);
+
+	/* the weights are positive, at most MaxWeight units. the size is their sum if they are given */
+	MinHittingSet(int n, const vec<int>* weights = NULL);
+	~MinHittingSet()                        { delete S; }
+
+	/* the difference between the sizes of two sets is a multiple of step() */
+	int      step      () const             { return unit; }
+
+	void     addSet    (const vec<int>& set);
+	/* finds a hitting set of size at most k, l_False if there is none.
+	 * l_Undef means that the solver was interrupted */
+	lbool    solve     (int k, vec<int>& out);
+	/* safe to call from a signal handler */
+	void     interrupt ()                   { interrupted = true; S->interrupt(); }
+};
+
+MinHittingSet::MinHittingSet(int n, const vec<int>* weights) : n(n), unit(1), total(n), width(0), S(NULL), interrupted(false)
+{
+	if (weights != NULL)
+	{
+		unit = 0;
+		foreach(i, n) unit = gcd((*weights)[i], unit);
+		total = 0;
+		assert(maxUnits(*weights) <= MaxWeight);
+		foreach(i, n)
+		{
+			weight.push((*weights)[i] / unit);
+			total += weight.last();
+		}
+	}
+	else weight.growTo(n, 1);
+	build(total < 16 ? total : 16);
+}
+
+int MinHittingSet::maxUnits(const vec<int>& weights)
+{
+	int g = 0, max = 0;
+	foreach(i, weights.size())
+	{
+		g = gcd(weights[i], g);
+		if (weights[i] > max) max = weights[i];
+	}
+	return g == 0 ? 0 : max / g;
+}
+
+void MinHittingSet::build(int w)
+{
+	delete S;
+	S     = new Solver;
+	width = w;
+	if (interrupted) S->interrupt();
+
+	foreach(i, n) S->newVar();
+	/* r(i, j) means that the weight of the chosen indices of 0..i is more than j */
+	vec<Var> prev, curr;
+	foreach(i, n)
+	{
+		curr.clear();
+		foreach(j, width) curr.push(S->newVar());
+		for (int j = 0; j < weight[i] && j < width; ++j) S->addClause(~mkLit(i), mkLit(curr[j]));
+		foreach(j, prev.size())
+		{
+			S->addClause(~mkLit(prev[j]), mkLit(curr[j]));
+			if (j + weight[i] < width) S->addClause(~mkLit(i), ~mkLit(prev[j]), mkLit(curr[j + weight[i]]));
+		}
+		curr.moveTo(prev);
+	}
+	prev.copyTo(atLeast);
+
+	vec<Lit> clause;
+	foreach(k, sets.size())
+	{
+		clause.clear();
+		foreach(i, sets[k].size()) clause.push(mkLit(sets[k][i]));
+		S->addClause_(clause);
+	}
+}
+
+void MinHittingSet::addSet(const vec<int>& set)
+{
+	vec<Lit> clause;
+	sets.push();
+	set.copyTo(sets.last());
+	foreach(i, set.size()) clause.push(mkLit(set[i]));
+	S->addClause_(clause);
+}
+
+lbool MinHittingSet::solve(int k, vec<int>& out)
+{
+	vec<Lit> assum;
+	k /= unit;
+	if (k < total)
+	{
+		if (k >= width)
+		{
+			int w = 2 * width < total ? 2 * width : total;
+			build(w < k + 1 ? k + 1 : w);
+		}
+		assum.push(~mkLit(atLeast[k]));
+	}
+	lbool ret = S->solveLimited(assum);
+	if (ret != l_True) return ret;
+	out.clear();
+	foreach(i, n) if (S->modelValue(i) == l_True) out.push(i);
+	return l_True;
+}
+
+}
+
+#endif /* MCA_HITTINGSET_H_ */
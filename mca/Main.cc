@@ -29,6 +29,8 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include "mca/Dimacs.h"
 #include "mca/Solver.h"
 #include "mca/AssumMinimiser.h"
+#include "mca/Portfolio.h"
+#include "mca/MusEnumerator.h"
 
 using namespace Minisat;
 
@@ -49,10 +51,29 @@ void printStats(Solver& solver)
 }
 
 
+// Writes a result set, terminated by 0. In -clause-mus mode the assumptions are the selectors,
+// and the indices of their clauses (from 1) are written instead.
+static void printSet(FILE* out, const vec<Lit>& set, bool clauseMus, Var firstSel)
+{
+    for (int i = 0; i < set.size(); ++i) {
+        if (clauseMus) fprintf(out, "%s%d", (i==0)?"":" ", var(set[i]) - firstSel + 1);
+        else           fprintf(out, "%s%s", (i==0)?"":" ", set[i].toString().c_str());
+    }
+    fprintf(out, " 0\n");
+}
+
+
 static Solver* solver;
+static Portfolio* portfolio = NULL;
+static AssumMinimiser* minimiser = NULL;
+static MusEnumerator* enumerator = NULL;
 // Terminate by notifying the solver and back out gracefully. This is mainly to have a test-case
 // for this feature of the Solver as it may take longer than an immediate call to '_exit()'.
-static void SIGINT_interrupt(int signum) { solver->interrupt(); }
+static void SIGINT_interrupt(int signum) {
+    solver->interrupt();
+    if (minimiser != NULL) minimiser->interrupt();
+    if (portfolio != NULL) portfolio->interrupt();
+    if (enumerator != NULL) enumerator->interrupt(); }
 
 // Note that '_exit()' rather than 'exit()' has to be used. The reason is that 'exit()' calls
 // destructors and may cause deadlocks if a malloc/free function happens to be running (these
@@ -83,16 +104,58 @@ int main(int argc, char** argv)
         // Extra options:
         //
         StringOption assum ("MAIN", "assum",  "If given, then the problem must be solved with the list of assumptions.");
+        BoolOption   clauseMus("MAIN", "clause-mus", "Minimize the set of clauses instead of assumptions: a selector is added to each clause while parsing,\n"
+                               "and the result is written as clause indices (from 1).", false);
         IntOption    verb   ("MAIN", "verb",   "Verbosity level (0=silent, 1=some, 2=more).", 1, IntRange(0, 2));
         IntOption    cpu_lim("MAIN", "cpu-lim","Limit on CPU time allowed in seconds.\n", INT32_MAX, IntRange(0, INT32_MAX));
         IntOption    mem_lim("MAIN", "mem-lim","Limit on memory usage in megabytes.\n", INT32_MAX, IntRange(0, INT32_MAX));
         IntOption    minimizer
-		("MAIN", "alg", "Choose which minimization algorithm to use.\n1=Iterative Deletion, 2=Improved Iterative Deletion, 3=Iterative Insertion, 4=Rotation Algorithm", 2, IntRange(1,4));
+		("MAIN", "alg", "Choose which minimization algorithm to use.\n1=Iterative Deletion, 2=Improved Iterative Deletion, 3=Iterative Insertion, 4=Rotation Algorithm, 5=QuickXplain, 6=Chunked Deletion, 7=Parallel Iterative Deletion, 8=Smallest Set (hitting sets),\n9=Necessary Assumptions (in every minimal set)", 2, IntRange(1,9));
+        IntOption    threads("MAIN", "threads", "Number of worker solvers (threads) for the parallel algorithms.\n", 4, IntRange(1, 1024));
+        StringOption portfolioSpec
+		("MAIN", "portfolio", "Run several algorithms in parallel threads, the first to finish wins.\n"
+		 "A comma separated list of <alg>[:<seed>], one thread per entry (e.g. 2,4:91648253,5:7).");
+        IntOption    callConf("MAIN", "call-conf", "Conflict budget of each solver call, a call that runs out of it is retried (0 = no budget).\n", 0, IntRange(0, INT32_MAX));
+        IntOption    callProp("MAIN", "call-prop", "Propagation budget of each solver call, a call that runs out of it is retried (0 = no budget).\n", 0, IntRange(0, INT32_MAX));
+        DoubleOption budgetInc("MAIN", "budget-inc", "The factor by which the budgets grow on each retry.", 2, DoubleRange(1, true, HUGE_VAL, false));
+        IntOption    deadline("MAIN", "deadline", "Wall-clock limit in seconds, then the smallest conflicting set found so far is written (0 = no limit).\n", 0, IntRange(0, INT32_MAX));
+        StringOption order  ("MAIN", "order", "Order of the assumptions before minimizing: file, activity, occurrence, conflict, random or weight.", "file");
+        DoubleOption orderSeed("MAIN", "order-seed", "Seed of -order=random and of the order of the trimming rounds.", 91648253, DoubleRange(0, false, HUGE_VAL, false));
+        IntOption    trim   ("MAIN", "trim", "Rounds of core trimming before minimizing, until the conflict stops shrinking (0 = none).\n", 0, IntRange(0, INT32_MAX));
+        BoolOption   harden ("MAIN", "harden", "Add the assumptions proven critical to the formula as unit clauses (algorithms 1, 2, 4 and 6).", false);
+        BoolOption   retire ("MAIN", "retire", "Fix the removed assumptions false, so the clauses they guard are removed (algorithms 1, 2, 4 and 6).", false);
+        BoolOption   stream ("MAIN", "stream", "Keep the output file up to date with every smaller conflicting set found.", false);
+        BoolOption   enumAll("MAIN", "all", "Enumerate all of the minimal conflicting sets of assumptions, each set is shrunk with -alg.", false);
+        IntOption    maxSets("MAIN", "max-sets", "Stop the enumeration (-all) after this many new sets (0 = no limit).\n", 0, IntRange(0, INT32_MAX));
+        IntOption    enumTime("MAIN", "enum-time", "Stop the enumeration (-all) after this many seconds (0 = no limit).\n", 0, IntRange(0, INT32_MAX));
+        StringOption resume ("MAIN", "resume", "Resume the enumeration (-all) of a previous run, given its output file.");
         
         parseOptions(argc, argv, true);
 
+        /* 9 finds the necessary assumptions, not a minimal conflicting set to block */
+        if (enumAll && minimizer == 9)
+            printf("ERROR! -all can't shrink the sets with -alg=9\n"), exit(1);
+
+        if (harden && (enumAll || portfolioSpec || !AssumMinimiser::canHarden(minimizer)))
+            printf("ERROR! -harden works with -alg=1, 2, 4 or 6 only, and not with -all or -portfolio\n"), exit(1);
+        if (retire && (enumAll || portfolioSpec || !AssumMinimiser::canHarden(minimizer)))
+            printf("ERROR! -retire works with -alg=1, 2, 4 or 6 only, and not with -all or -portfolio\n"), exit(1);
+        /* the enumeration and the portfolio workers solve without budgets, and the enumeration
+         * stops with -enum-time */
+        if ((callConf > 0 || callProp > 0) && (enumAll || portfolioSpec))
+            printf("ERROR! -call-conf and -call-prop can't be used with -all or -portfolio\n"), exit(1);
+        if (deadline > 0 && (enumAll || portfolioSpec))
+            printf("ERROR! -deadline can't be used with -all (see -enum-time) or -portfolio\n"), exit(1);
+        /* the portfolio workers don't see the output file, and -all writes each set as it finds it */
+        if (stream && (enumAll || portfolioSpec))
+            printf("ERROR! -stream can't be used with -all or -portfolio\n"), exit(1);
+        if (trim > 0 && (enumAll || portfolioSpec))
+            printf("ERROR! -trim can't be used with -all or -portfolio\n"), exit(1);
+
         Solver S;
         vec<Lit> userAssum;
+        vec<vec<Lit> > assumGroups;
+        vec<int> assumWeights;
 
         double initial_time = cpuTime();
 
@@ -136,17 +199,30 @@ int main(int argc, char** argv)
             printf("============================[ Problem Statistics ]=============================\n");
             printf("|                                                                             |\n"); }
         
-        parse_DIMACS(in, S);
+        vec<Lit> selectors;
+        if (clauseMus) parse_DIMACS(in, S, selectors);
+        else           parse_DIMACS(in, S);
         gzclose(in);
 
         gzFile assumFile = NULL;
-        if (assum)
+        Var    firstSel  = var_Undef;
+        if (clauseMus)
+        {
+        	if (assum)
+        		printf("ERROR! -clause-mus makes its own assumptions, it can't be used with -assum\n"), exit(1);
+        	if (enumAll || stream || resume)
+        		printf("ERROR! -clause-mus can't be used with -all, -stream or -resume\n"), exit(1);
+        	printf("|                   Added a selector to each of the %9d clauses         |\n", selectors.size());
+        	selectors.copyTo(userAssum);
+        	if (selectors.size() > 0) firstSel = var(selectors[0]);
+        }
+        else if (assum)
         {
         	assumFile = gzopen(assum.getStr(), "rb");
         	if(assumFile)
         	{
             	printf("|                           Adding assumptions!                               |\n");
-                parse_DIMACS_assumptions(assumFile, S.nVars(), userAssum);
+                parse_DIMACS_assumptions(assumFile, S.nVars(), userAssum, assumGroups, assumWeights);
                 gzclose(assumFile);
         	} else {
         		printf("ERROR! Could not open file: %s\n", assum.getStr()), exit(1);
@@ -156,12 +232,45 @@ int main(int argc, char** argv)
         	return 1;
         }
 
+        const bool haveAssum = assum || clauseMus;
+
+        /* the minimizers ignore the weights if they are all 1 */
+        bool    weighted    = false;
+        int64_t totalWeight = 0;
+        foreach(i, assumWeights.size()) {
+        	weighted    |= assumWeights[i] != 1;
+        	totalWeight += assumWeights[i];
+        }
+        if (totalWeight > INT32_MAX)
+        	printf("ERROR! The total weight of the assumptions is too large: %"PRId64"\n", totalWeight), exit(1);
+        vec<Lit> weightedAssum;   // in the order of the file, as assumWeights
+        if (weighted) userAssum.copyTo(weightedAssum);
+        /* the hitting sets of -alg=8 need a counter as wide as the weights */
+        const bool tooHeavy = weighted && MinHittingSet::maxUnits(assumWeights) > MinHittingSet::MaxWeight;
+        if (tooHeavy && minimizer == 8 && !portfolioSpec)
+        	printf("ERROR! -alg=8 supports weights of up to %d times their gcd\n", (int)MinHittingSet::MaxWeight), exit(1);
+
+        /* read before the output file is opened, as it may be the same file */
+        vec<vec<Lit> > resumedSets;
+        if (resume)
+        {
+        	gzFile resumeFile = gzopen(resume.getStr(), "rb");
+        	if (resumeFile == NULL)
+        		printf("ERROR! Could not open file: %s\n", resume.getStr()), exit(1);
+        	parse_MCA_sets(resumeFile, S.nVars(), resumedSets);
+        	gzclose(resumeFile);
+        }
+
         FILE* outfile = (argc >= 3) ? fopen(argv[2], "wb") : NULL;
 
         if (S.verbosity > 0){
             printf("|  Number of variables:  %12d                                         |\n", S.nVars());
             printf("|  Number of clauses:    %12d                                         |\n", S.nClauses());
             printf("|  Number of assumptions:%12d                                         |\n", userAssum.size());
+            if (assumGroups.size() > 0)
+            printf("|  Number of groups:     %12d                                         |\n", assumGroups.size());
+            if (weighted)
+            printf("|  Total weight:         %12"PRId64"                                         |\n", totalWeight);
         }
         
         double parsed_time = cpuTime();
@@ -173,6 +282,8 @@ int main(int argc, char** argv)
         // voluntarily:
         signal(SIGINT, SIGINT_interrupt);
         signal(SIGXCPU,SIGINT_interrupt);
+        signal(SIGALRM,SIGINT_interrupt);
+        if (deadline > 0) alarm(deadline);
        
         if (!S.simplify()){
             if (outfile != NULL) fprintf(outfile, "UNSAT without assumptions\nNothing to Minimize\n"), fclose(outfile);
@@ -184,10 +295,38 @@ int main(int argc, char** argv)
             printf("UNSATISFIABLE without assumptions\nNothing to Minimize\n");
             exit(20);
         }
+        /* the minimizers only see the first literal of each group */
+        AssumGroups* groups = assumGroups.size() > 0 ? new AssumGroups(S.nVars(), assumGroups) : NULL;
         AssumMinimiser am(S, userAssum);
+        am.setGroups(groups);
+        if (weighted) am.setWeights(weightedAssum, assumWeights);
+        am.setThreads(threads);
+        am.setBudgets(callConf, callProp, budgetInc);
+        am.setHarden(harden);
+        am.setRetire(retire);
+        /* the necessary assumptions aren't conflicting sets */
+        AnytimeOutput* anytime = NULL;
+        if (stream && outfile != NULL && minimizer != 9) {
+        	anytime = new AnytimeOutput(argv[2]);
+        	am.setStream(anytime);
+        }
+        minimiser = &am;
         lbool ret = l_Undef;
         vec<Lit> assumRes;
-        ret = am.isSatWithAssum();
+        try {
+            ret = am.isSatWithAssum();
+        } catch (InterruptedException&) {
+            ret = l_Undef;
+        }
+        if (ret == l_False)
+        {
+        	int orderKind = AssumMinimiser::orderByName(order);
+        	if (orderKind < 0)
+        		printf("ERROR! Illegal order: %s\n", (const char*)order), exit(1);
+        	/* the enumeration and the portfolio use the same order */
+        	am.orderAssumptions(orderKind, orderSeed);
+        	am.assumptions().copyTo(userAssum);
+        }
         if (ret == l_True)
         {
             if (outfile != NULL) {
@@ -198,59 +337,109 @@ int main(int argc, char** argv)
             }
             exit(20);
         }
-        if (assum && ret == l_False)
-
+        if (haveAssum && ret == l_False && enumAll)
         {
-        	switch (minimizer)
-        	{
-        	case 1:
-        		printf("Using Iterative Deletion Algorithm for minimizing the conflicting set of assumptions\n");
-        		am.iterativeDel(assumRes);
-        		break;
-        	case 2:
-        		printf("Using Iterative Deletion Algorithm with MiniSAT's minimizer for minimizing the conflicting set of assumptions\n");
-        		am.iterativeDel2(assumRes);
-        		break;
-        	case 3:
-        		printf("Using Iterative Insertion Algorithm for minimizing the conflicting set of assumptions\n");
-        		am.iterativeIns(assumRes);
-        		break;
-            case 4:
-                printf("Using Rotation Algorithm for minimizing the conflicting set of assumptions\n");
-                am.rotationAlg(assumRes);
-                break;
-        	default:
-        		printf("Internal error!\n");
-        		exit(1);
+        	printf("Enumerating the minimal conflicting sets of assumptions using the %s\n", AssumMinimiser::algName(minimizer));
+        	FILE* setsOut = (outfile != NULL) ? outfile : stdout;
+        	fprintf(setsOut, "Conflicting Assumption Sets:\n");
+        	MusEnumerator me(S, userAssum, minimizer, setsOut);
+        	me.setThreads(threads);
+        	me.setGroups(groups);
+        	me.setLimits(maxSets, enumTime);
+        	foreach(i, resumedSets.size()) me.resume(resumedSets[i]);
+        	enumerator = &me;
+        	try {
+        		fprintf(setsOut, me.run() ? "Complete\n" : "Incomplete\n");
+        	} catch (InterruptedException&) {
+        		fprintf(setsOut, "Incomplete\n");
+        	}
+        	enumerator = NULL;
+        	if (outfile != NULL) fclose(outfile);
+        	printf("Found %d new sets, %d resumed, with %d solver calls\n", me.nSets(), resumedSets.size(), me.nSolveCalls());
+        	exit(20);
+        }
+        else if (haveAssum && ret == l_False && portfolioSpec)
+        {
+        	if (argc == 1)
+        		printf("ERROR! The portfolio needs an input file, it can't read from standard input\n"), exit(1);
+        	Portfolio pf(argv[1], userAssum);
+        	pf.setClauseMus(clauseMus);
+        	pf.setGroups(groups);
+        	if (weighted) {
+        		vec<int> w;
+        		foreach(i, userAssum.size()) w.push(am.weightOf(userAssum[i]));
+        		pf.setWeights(w);
+        	}
+        	if (!pf.addWorkers(portfolioSpec))
+        		printf("ERROR! Illegal portfolio: %s\n", (const char*)portfolioSpec), exit(1);
+        	if (tooHeavy && pf.hasAlg(8))
+        		printf("ERROR! -alg=8 supports weights of up to %d times their gcd\n", (int)MinHittingSet::MaxWeight), exit(1);
+        	printf("Using a portfolio of %d threads for minimizing the conflicting set of assumptions\n", pf.nWorkers());
+        	portfolio = &pf;
+        	if (pf.run(assumRes)) {
+        		printf("Thread %d won using the %s\n", pf.winnerId(), AssumMinimiser::algName(pf.winnerAlg()));
+        	} else {
+        		ret = l_Undef;
+        	}
+        	portfolio = NULL;
+        }
+        else if (haveAssum && ret == l_False)
+        {
+        	printf("Using %s for minimizing the conflicting set of assumptions\n", AssumMinimiser::algName(minimizer));
+        	try {
+        		if (trim > 0) {
+        			int rounds = am.trimCore(trim, orderSeed);
+        			printf("Trimmed the conflict in %d rounds\n", rounds);
+        		}
+        		am.minimise(minimizer, assumRes);
+        	} catch (InterruptedException&) {
+        		ret = l_Undef;
         	}
         }
         
+        /* the necessary assumptions are not a conflicting set */
+        const char* resultLabel = (minimizer == 9 && !portfolioSpec) ? (clauseMus ? "Necessary Clauses" : "Necessary Assumptions")
+                                                                     : (clauseMus ? "Conflicting Clauses" : "Conflicting Assumptions");
+        /* when interrupted, the smallest conflicting set so far is better than nothing */
+        bool partial = ret == l_Undef && (minimizer != 9 || portfolioSpec) && am.bestSoFar(assumRes);
+        if (partial) {
+        	resultLabel = clauseMus ? "Conflicting Clauses (not minimal)" : "Conflicting Assumptions (not minimal)";
+        	printf("Interrupted, writing the smallest conflicting set found so far\n");
+        }
         if (S.verbosity > 0){
             am.PrintStats();
             printf("\n");
         }
+        if (weighted && (ret == l_False || partial) && (minimizer != 9 || portfolioSpec))
+            printf("Weight of the conflicting set: %"PRId64"\n", am.weight(assumRes));
+        if (groups != NULL) {
+            vec<Lit> lits;
+            groups->expand(assumRes, lits);
+            lits.moveTo(assumRes);
+        }
         //printf(ret == l_True ? "SATISFIABLE\n" : ret == l_False ? "UNSATISFIABLE\n" : "INDETERMINATE\n");
-        if (outfile != NULL){
-            if (ret == l_False) {
+        if (anytime != NULL && anytime->nUpdates() > 0 && (ret == l_False || partial)) {
+            /* the stream replaced the output file, the result replaces it the same way */
+            fclose(outfile);
+            if (!anytime->write(resultLabel, assumRes, am.nSolveCalls()))
+                printf("ERROR! Could not write the result to: %s\n", argv[2]);
+        } else if (outfile != NULL){
+            if (ret == l_False || partial) {
                 /* if assumptions were passed and we got UNSAT,
                  * then we'll print conflicting assumptions */
-                if(assum) {
-                    fprintf(outfile, "Conflicting Assumptions:\n");
-                	for (int i = 0; i < assumRes.size(); ++i) {
-                		fprintf(outfile, "%s%s", (i==0)?"":" ", assumRes[i].toString().c_str());
-                	}
-                    fprintf(outfile, " 0\n");
+                if(haveAssum) {
+                    fprintf(outfile, "%s:\n", resultLabel);
+                    printSet(outfile, assumRes, clauseMus, firstSel);
                 }
             }
             else //ret == l_Undef
                 fprintf(outfile, "INDET\n");
             fclose(outfile);
+        } else if (ret == l_Undef && !partial) {
+        	printf("INDETERMINATE\n");
         } else {
-        	printf("Conflicting Assumptions:\n");
-        	for (int i = 0; i < assumRes.size(); ++i) {
-        	    printf("%s%s", (i==0)?"":" ", assumRes[i].toString().c_str());
-        	}
-        	printf(" 0\n");
+        	printf("%s:\n", resultLabel);
+        	printSet(stdout, assumRes, clauseMus, firstSel);
         }
         
 #ifdef NDEBUG
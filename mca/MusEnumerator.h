@@ -0,0 +1,221 @@
+/*
+ * MusEnumerator.h
+ *
+ *  Enumerates all of the minimal conflicting subsets of the assumptions (MARCO).
+ *  A second "map" solver, with one variable per assumption, holds the subsets that
+ *  weren't explored yet: the supersets of every minimal set found are blocked, and
+ *  so are the subsets of every maximal satisfiable subset. Each unexplored UNSAT
+ *  subset is shrunk with AssumMinimiser, and each minimal set is written out as
+ *  soon as it's found.
+ */
+
+#ifndef MCA_MUSENUMERATOR_H_
+#define MCA_MUSENUMERATOR_H_
+
+#include <stdio.h>
+
+#include "utils/System.h"
+#include "mca/Solver.h"
+#include "mca/AssumMinimiser.h"
+#include "mca/global_defs.h"
+
+namespace Minisat {
+
+class MusEnumerator {
+	Solver&          s;
+	vec<Lit>         initAssum;
+	Solver           map;          // variable i stands for initAssum[i], true means the assumption is in the subset
+	vec<int>         assumIdx;     // the index in initAssum of every literal of s, -1 if it's not an assumption
+	int              alg;          // the AssumMinimiser algorithm that shrinks the seeds
+	int              nThreads;
+	FILE            *out;
+
+	int              maxSets;      // 0 means no limit
+	double           maxSeconds;   // 0 means no limit
+	int              nFound;
+	int              nCalls;       // solver calls, including those of the AssumMinimisers
+	AssumMinimiser  *shrinker;     // the one shrinking the current seed, if any
+	const AssumGroups *groups;     // if not NULL, some of the assumptions represent groups
+
+	lbool            solve   (const vec<Lit>& assum);
+	bool             satisfied(Lit l) const            { return groups != NULL ? groups->satisfied(s, l) : s.modelValue(l) == l_True; }
+	/* extends the satisfiable seed to a maximal satisfiable subset */
+	void             grow    (vec<Lit>& seed);
+	/* the supersets of a minimal set / the subsets of a maximal satisfiable set are explored */
+	void             blockUp  (const vec<Lit>& mus);
+	void             blockDown(const vec<Lit>& mss);
+	void             report  (const vec<Lit>& mus);
+
+public:
+	MusEnumerator(Solver& s, const vec<Lit>& assum, int alg, FILE* out);
+
+	void     setThreads (int n)                        { nThreads = n; }
+	/* the assumptions that represent groups, the sets are written with the groups expanded */
+	void     setGroups  (const AssumGroups* g)         { groups = g; }
+	void     setLimits  (int sets, double seconds)     { maxSets = sets; maxSeconds = seconds; }
+	/* a minimal set found by a previous run, it is written out again but not counted */
+	void     resume     (const vec<Lit>& mus);
+
+	/* returns true if all of the minimal sets were found, false if a limit was hit first */
+	bool     run        ();
+	int      nSets      () const                       { return nFound; }
+	int      nSolveCalls() const                       { return nCalls; }
+	/* interrupts the solver and the current minimiser, safe to call from a signal handler */
+	void     interrupt  ()                             { s.interrupt(); if (shrinker != NULL) shrinker->interrupt(); }
+};
+
+MusEnumerator::MusEnumerator(Solver& s, const vec<Lit>& assum, int alg, FILE* out)
+	: s(s), alg(alg), nThreads(1), out(out), maxSets(0), maxSeconds(0), nFound(0), nCalls(0), shrinker(NULL), groups(NULL)
+{
+	assert(alg != 9);   /* the necessary assumptions aren't a minimal set */
+	assumIdx.growTo(2 * s.nVars(), -1);
+	foreach(i, assum.size())
+	{
+		if (assumIdx[toInt(assum[i])] >= 0) continue; /* a repeated assumption */
+		assumIdx[toInt(assum[i])] = initAssum.size();
+		initAssum.push(assum[i]);
+		map.newVar(false); /* the seeds are as large as possible */
+	}
+}
+
+lbool MusEnumerator::solve(const vec<Lit>& assum)
+{
+	lbool ret;
+	if (groups != NULL)
+	{
+		vec<Lit> expanded;
+		groups->expand(assum, expanded);
+		ret = s.solveLimited(expanded);
+		if (ret == l_False) groups->mapConflict(s.conflict);
+	}
+	else
+		ret = s.solveLimited(assum);
+	if (ret == l_Undef) throw InterruptedException();
+	nCalls++;
+	return ret;
+}
+
+void MusEnumerator::grow(vec<Lit>& seed)
+{
+	vec<char> inSeed(initAssum.size(), 0);
+	foreach(i, seed.size()) inSeed[assumIdx[toInt(seed[i])]] = 1;
+
+	foreach(i, initAssum.size())
+	{
+		if (inSeed[i]) continue;
+		if (!satisfied(initAssum[i]))
+		{
+			seed.push(initAssum[i]);
+			if (solve(seed) == l_False)
+			{
+				seed.pop();
+				continue;
+			}
+		}
+		else
+			seed.push(initAssum[i]);
+		inSeed[i] = 1;
+		/* the assumptions that the model satisfies come for free */
+		for (int j = i + 1; j < initAssum.size(); ++j)
+			if (!inSeed[j] && satisfied(initAssum[j]))
+				seed.push(initAssum[j]), inSeed[j] = 1;
+	}
+}
+
+void MusEnumerator::blockUp(const vec<Lit>& mus)
+{
+	vec<Lit> clause;
+	foreach(i, mus.size()) clause.push(~mkLit(assumIdx[toInt(mus[i])]));
+	map.addClause_(clause);
+}
+
+void MusEnumerator::blockDown(const vec<Lit>& mss)
+{
+	vec<char> inMss(initAssum.size(), 0);
+	vec<Lit>  clause;
+	foreach(i, mss.size()) inMss[assumIdx[toInt(mss[i])]] = 1;
+	foreach(i, initAssum.size()) if (!inMss[i]) clause.push(mkLit(i));
+	map.addClause_(clause);
+}
+
+void MusEnumerator::report(const vec<Lit>& mus)
+{
+	vec<Lit> lits;
+	if (groups != NULL) groups->expand(mus, lits);
+	else mus.copyTo(lits);
+	foreach(i, lits.size()) fprintf(out, "%s%s", (i==0)?"":" ", lits[i].toString().c_str());
+	fprintf(out, "%s0\n", lits.size() == 0 ? "" : " ");
+	fflush(out);
+}
+
+void MusEnumerator::resume(const vec<Lit>& set)
+{
+	/* the sets were written with the groups expanded */
+	vec<Lit> mus;
+	set.copyTo(mus);
+	if (groups != NULL) groups->toReps(mus);
+	foreach(i, mus.size())
+		if (toInt(mus[i]) >= assumIdx.size() || assumIdx[toInt(mus[i])] < 0)
+			printf("ERROR! Resumed set has a literal that isn't an assumption: %s\n", mus[i].toString().c_str()), exit(1);
+	report(mus);
+	blockUp(mus);
+}
+
+bool MusEnumerator::run()
+{
+	double    start = realTime();
+	vec<Lit>  seed, core, mus;
+	vec<char> inCore;
+
+	while (maxSets == 0 || nFound < maxSets)
+	{
+		if (maxSeconds > 0 && realTime() - start >= maxSeconds) return false;
+		if (!map.solve()) return true;
+
+		seed.clear();
+		foreach(i, initAssum.size()) if (map.modelValue(i) == l_True) seed.push(initAssum[i]);
+
+		if (solve(seed) == l_True)
+		{
+			grow(seed);
+			blockDown(seed);
+			continue;
+		}
+
+		/* only the assumptions of the final conflict need to be shrunk */
+		inCore.clear();
+		inCore.growTo(initAssum.size(), 0);
+		foreach(i, s.conflict.size())
+		{
+			int idx = assumIdx[toInt(~s.conflict[i])];
+			if (idx >= 0) inCore[idx] = 1;
+		}
+		core.clear();
+		foreach(i, seed.size()) if (inCore[assumIdx[toInt(seed[i])]]) core.push(seed[i]);
+		mus.clear();
+		if (core.size() > 0)
+		{
+			AssumMinimiser am(s, core);
+			am.setThreads(nThreads);
+			am.setGroups(groups);
+			shrinker = &am;
+			try {
+				am.isSatWithAssum();
+				am.minimise(alg, mus);
+			} catch (InterruptedException&) {
+				shrinker = NULL;
+				throw;
+			}
+			nCalls  += am.nSolveCalls();
+			shrinker = NULL;
+		}
+		report(mus);
+		blockUp(mus);
+		nFound++;
+	}
+	return false;
+}
+
+}
+
+#endif /* MCA_MUSENUMERATOR_H_ */
@@ -0,0 +1,180 @@
+/*
+ * Portfolio.h
+ *
+ *  Runs several AssumMinimiser algorithms in parallel, each one in its own thread
+ *  with its own Solver. The first one to finish wins, the rest are interrupted.
+ *  The solvers share their short learnt clauses through a ClauseExchange.
+ */
+
+#ifndef MCA_PORTFOLIO_H_
+#define MCA_PORTFOLIO_H_
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <zlib.h>
+
+#include "mca/Dimacs.h"
+#include "mca/AssumMinimiser.h"
+#include "mca/ClauseExchange.h"
+
+namespace Minisat {
+
+class Portfolio;
+
+struct PortfolioWorker
+{
+	int         id;
+	int         alg;
+	double      seed;      // 0 means that the solver's default seed is used
+	Solver      S;
+	vec<Lit>    result;
+	pthread_t   thread;
+	Portfolio  *portfolio;
+};
+
+class Portfolio {
+	const char             *cnfFile;
+	vec<Lit>                assum;
+	vec<PortfolioWorker*>   workers;
+	pthread_mutex_t         lock;
+	int                     winner;
+	ClauseExchange         *exchange;
+	bool                    clauseMus;   // the workers add a selector to each clause while parsing
+	const AssumGroups      *groups;      // if not NULL, some of the assumptions represent groups
+	vec<int>                weights;     // of assum, empty if they aren't weighted
+
+	static void* runWorker(void* arg);
+	void         finish   (PortfolioWorker& w);
+
+public:
+	Portfolio(const char* cnfFile, const vec<Lit>& userAssum) : cnfFile(cnfFile), winner(-1), exchange(NULL), clauseMus(false), groups(NULL)
+	{
+		userAssum.copyTo(assum);
+		pthread_mutex_init(&lock, NULL);
+	}
+	~Portfolio()
+	{
+		foreach(i, workers.size()) delete workers[i];
+		delete exchange;
+		pthread_mutex_destroy(&lock);
+	}
+
+	/* spec is a comma separated list of <alg>[:<seed>], one thread per entry.
+	 * returns false if spec is illegal */
+	bool     addWorkers(const char* spec);
+	int      nWorkers  () const     { return workers.size(); }
+	int      winnerAlg () const     { return winner < 0 ? 0 : workers[winner]->alg; }
+	int      winnerId  () const     { return winner; }
+	bool     hasAlg    (int alg) const { foreach(i, workers.size()) if (workers[i]->alg == alg) return true; return false; }
+	/* the workers parse the formula with selectors, as the assumptions were made (see parse_DIMACS_main) */
+	void     setClauseMus(bool b)   { clauseMus = b; }
+	/* the assumptions that represent groups, the result is given by the representatives */
+	void     setGroups  (const AssumGroups* g)  { groups = g; }
+	/* w[i] is the weight of the i-th assumption (see AssumMinimiser::setWeights) */
+	void     setWeights (const vec<int>& w)     { w.copyTo(weights); }
+
+	/* returns false if no thread finished (all were interrupted) */
+	bool     run       (vec<Lit>& result);
+	/* interrupts all of the threads, safe to call from a signal handler */
+	void     interrupt ();
+};
+
+bool Portfolio::addWorkers(const char* spec)
+{
+	const char *p = spec;
+	char       *end;
+	while (*p != '\0')
+	{
+		PortfolioWorker *w = new PortfolioWorker;
+		w->id        = workers.size();
+		w->portfolio = this;
+		w->seed      = 0;
+		w->alg       = strtol(p, &end, 10);
+		workers.push(w);
+		/* 9 finds the necessary assumptions, not a conflicting set */
+		if (end == p || AssumMinimiser::algName(w->alg) == NULL || w->alg == 9) return false;
+		p = end;
+		if (*p == ':')
+		{
+			w->seed = strtod(p + 1, &end);
+			if (end == p + 1 || w->seed <= 0) return false;
+			p = end;
+		}
+		if (*p == ',') p++;
+		else if (*p != '\0') return false;
+	}
+	return workers.size() > 0;
+}
+
+bool Portfolio::run(vec<Lit>& result)
+{
+	exchange = new ClauseExchange(workers.size());
+	foreach(i, workers.size())
+	{
+		PortfolioWorker& w = *workers[i];
+		w.S.verbosity = 0;
+		if (workers.size() > 1) w.S.setExchange(exchange, i);
+		if (w.seed > 0)
+		{
+			w.S.random_seed  = w.seed;
+			w.S.rnd_init_act = true;
+		}
+		if (pthread_create(&w.thread, NULL, runWorker, &w) != 0)
+			printf("ERROR! Could not create thread %d\n", i), exit(1);
+	}
+	foreach(i, workers.size()) pthread_join(workers[i]->thread, NULL);
+
+	if (winner < 0) return false;
+	workers[winner]->result.copyTo(result);
+	return true;
+}
+
+void Portfolio::interrupt()
+{
+	foreach(i, workers.size()) workers[i]->S.interrupt();
+}
+
+void Portfolio::finish(PortfolioWorker& w)
+{
+	pthread_mutex_lock(&lock);
+	if (winner < 0)
+	{
+		winner = w.id;
+		foreach(i, workers.size())
+			if (i != w.id) workers[i]->S.interrupt();
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+void* Portfolio::runWorker(void* arg)
+{
+	PortfolioWorker& w  = *(PortfolioWorker*)arg;
+	Portfolio&       pf = *w.portfolio;
+	try {
+		gzFile in = gzopen(pf.cnfFile, "rb");
+		if (in == NULL) return NULL;
+		vec<Lit> selectors;
+		if (pf.clauseMus) parse_DIMACS(in, w.S, selectors);
+		else              parse_DIMACS(in, w.S);
+		gzclose(in);
+
+		/* if the formula is UNSAT without assumptions, the result is empty */
+		if (w.S.simplify())
+		{
+			AssumMinimiser am(w.S, pf.assum);
+			am.setGroups(pf.groups);
+			if (pf.weights.size() > 0) am.setWeights(pf.assum, pf.weights);
+			if (am.isSatWithAssum() == l_False) am.minimise(w.alg, w.result);
+		}
+		pf.finish(w);
+	} catch (InterruptedException&) {
+		TRACE("Thread " << w.id << " was interrupted");
+	} catch (OutOfMemoryException&) {
+		TRACE("Thread " << w.id << " is out of memory");
+	}
+	return NULL;
+}
+
+}
+
+#endif /* MCA_PORTFOLIO_H_ */
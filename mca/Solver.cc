@@ -22,6 +22,7 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 
 #include "mtl/Sort.h"
 #include "mca/Solver.h"
+#include "mca/ClauseExchange.h"
 #include "utils/System.h"
 #include "global_defs.h"
 
@@ -43,6 +44,8 @@ static BoolOption    opt_rnd_init_act      (_cat, "rnd-init",    "Randomize the
 static BoolOption    opt_luby_restart      (_cat, "luby",        "Use the Luby restart sequence", true);
 static IntOption     opt_restart_first     (_cat, "rfirst",      "The base restart interval", 100, IntRange(1, INT32_MAX));
 static DoubleOption  opt_restart_inc       (_cat, "rinc",        "Restart interval increase factor", 2, DoubleRange(1, false, HUGE_VAL, false));
+static IntOption     opt_share_max_len     (_cat, "share-len",   "Learnt clauses up to this size are shared between parallel solvers", 8, IntRange(0, ClauseExchange::MaxLen));
+static IntOption     opt_share_max_lbd     (_cat, "share-lbd",   "Learnt clauses up to this LBD are shared between parallel solvers", 2, IntRange(0, INT32_MAX));
 static DoubleOption  opt_garbage_frac      (_cat, "gc-frac",     "The fraction of wasted memory allowed before a garbage collection is triggered",  0.20, DoubleRange(0, false, HUGE_VAL, false));
 
 
@@ -76,11 +79,14 @@ Solver::Solver() :
     //
   , learntsize_adjust_start_confl (100)
   , learntsize_adjust_inc         (1.5)
+  , share_max_len                 (opt_share_max_len)
+  , share_max_lbd                 (opt_share_max_lbd)
 
     // Statistics: (formerly in 'SolverStats')
     //
   , solves(0), starts(0), decisions(0), rnd_decisions(0), propagations(0), conflicts(0)
   , dec_vars(0), clauses_literals(0), learnts_literals(0), max_literals(0), tot_literals(0)
+  , shared_exported(0), shared_imported(0)
 
   , ok                 (true)
   , cla_inc            (1)
@@ -92,12 +98,19 @@ Solver::Solver() :
   , order_heap         (VarOrderLt(activity))
   , progress_estimate  (0)
   , remove_satisfied   (true)
+  , occurs             (ClauseDeleted(ca))
+  , occurs_built       (false)
+  , model_occ_built    (false)
 
     // Resource constraints:
     //
   , conflict_budget    (-1)
   , propagation_budget (-1)
   , asynch_interrupt   (false)
+
+  , exchange           (NULL)
+  , exchange_id        (0)
+  , lbd_counter        (0)
 {}
 
 
@@ -118,6 +131,9 @@ Var Solver::newVar(bool sign, bool dvar)
     int v = nVars();
     watches  .init(mkLit(v, false));
     watches  .init(mkLit(v, true ));
+    if (occurs_built){
+        occurs.init(mkLit(v, false));
+        occurs.init(mkLit(v, true )); }
     assigns  .push(l_Undef);
     vardata  .push(mkVarData(CRef_Undef, 0));
     //activity .push(0);
@@ -155,6 +171,10 @@ bool Solver::addClause_(vec<Lit>& ps)
         CRef cr = ca.alloc(ps, false);
         clauses.push(cr);
         attachClause(cr);
+        model_occ_built = false;
+        if (occurs_built)
+            for (int k = 0; k < ps.size(); k++)
+                occurs[ps[k]].push(cr);
     }
 
     return true;
@@ -192,6 +212,10 @@ void Solver::removeClause(CRef cr) {
     detachClause(cr);
     // Don't leave pointers to free'd memory!
     if (locked(c)) vardata[var(c[0])].reason = CRef_Undef;
+    if (!c.learnt()) model_occ_built = false;
+    if (occurs_built && !c.learnt())
+        for (int k = 0; k < c.size(); k++)
+            occurs.smudge(c[k]);
     c.mark(1); 
     ca.free(cr);
 }
@@ -600,6 +624,77 @@ bool Solver::simplify()
 }
 
 
+/*_________________________________________________________________________________________________
+|
+|  Clause sharing:
+|
+|  Description:
+|    Learnt clauses are implied by the original clauses alone (the assumptions are only decisions),
+|    so a clause learnt by a solver of the same problem is sound for any set of assumptions, even
+|    if it's over the assumption variables. They aren't filtered. NOTE: this needs every solver
+|    of the exchange to have the same clauses, -harden and -retire add clauses and never share.
+|________________________________________________________________________________________________@*/
+void Solver::setExchange(ClauseExchange* ex, int id)
+{
+    exchange    = ex;
+    exchange_id = id;
+}
+
+void Solver::exportLearnt(const vec<Lit>& learnt)
+{
+    if (learnt.size() > ClauseExchange::MaxLen) return;
+    if (learnt.size() > share_max_len){
+        // Count the distinct decision levels (LBD):
+        lbd_counter++;
+        lbd_stamp.growTo(decisionLevel() + 1, 0);
+        int lbd = 0;
+        for (int i = 0; i < learnt.size() && lbd <= share_max_lbd; i++){
+            int lev = level(var(learnt[i]));
+            if (lbd_stamp[lev] != lbd_counter){
+                lbd_stamp[lev] = lbd_counter;
+                lbd++; }
+        }
+        if (lbd > share_max_lbd) return;
+    }
+    exchange->exportClause(exchange_id, learnt);
+    shared_exported++;
+}
+
+bool Solver::importShared()
+{
+    assert(decisionLevel() == 0);
+    vec<Lit>& lits = add_tmp;
+    while (exchange->importClause(exchange_id, lits)){
+        shared_imported++;
+
+        // Remove false literals, skip satisfied clauses:
+        bool sat = false;
+        int  i, j;
+        for (i = j = 0; i < lits.size() && !sat; i++)
+            if (value(lits[i]) == l_True)
+                sat = true;
+            else if (value(lits[i]) == l_Undef)
+                lits[j++] = lits[i];
+        if (sat) continue;
+        lits.shrink(i - j);
+
+        if (lits.size() == 0)
+            return ok = false;
+        else if (lits.size() == 1){
+            uncheckedEnqueue(lits[0]);
+            if (propagate() != CRef_Undef)
+                return ok = false;
+        }else{
+            CRef cr = ca.alloc(lits, true);
+            learnts.push(cr);
+            attachClause(cr);
+            claBumpActivity(ca[cr]);
+        }
+    }
+    return true;
+}
+
+
 /*_________________________________________________________________________________________________
 |
 |  search : (nof_conflicts : int) (params : const SearchParams&)  ->  [lbool]
@@ -621,6 +716,9 @@ lbool Solver::search(int nof_conflicts)
     vec<Lit>    learnt_clause;
     starts++;
 
+    // Restart boundary, pick up the clauses learnt by the other solvers:
+    if (exchange != NULL && !importShared()) return l_False;
+
     for (;;){
         CRef confl = propagate();
         if (confl != CRef_Undef){
@@ -630,6 +728,7 @@ lbool Solver::search(int nof_conflicts)
 
             learnt_clause.clear();
             analyze(confl, learnt_clause, backtrack_level);
+            if (exchange != NULL) exportLearnt(learnt_clause);
             cancelUntil(backtrack_level);
 
             if (learnt_clause.size() == 1){
@@ -899,6 +998,18 @@ void Solver::relocAll(ClauseAllocator& to)
             ca.reloc(vardata[v].reason, to);
     }
 
+    // All occurrences:
+    //
+    if (occurs_built){
+        occurs.cleanAll();
+        for (int v = 0; v < nVars(); v++)
+            for (int s = 0; s < 2; s++){
+                vec<CRef>& cs = occurs[mkLit(v, s)];
+                for (int j = 0; j < cs.size(); j++)
+                    ca.reloc(cs[j], to);
+            }
+    }
+
     // All learnt:
     //
     for (int i = 0; i < learnts.size(); i++)
@@ -969,6 +1080,164 @@ bool    Solver::checkIfModel(vec<lbool>& inAssign)
 	return true;
 }
 
+void Solver::copyProblemTo(Solver& to) const
+{
+    assert(decisionLevel() == 0);
+    vec<Lit> lits;
+    while (to.nVars() < nVars()){
+        Var v = to.nVars();
+        to.newVar(polarity[v], decision[v]); }
+
+    if (!ok){
+        to.addEmptyClause();
+        return; }
+    for (int i = 0; i < trail.size(); i++)
+        to.addClause(trail[i]);
+    for (int i = 0; i < clauses.size(); i++){
+        const Clause& c = ca[clauses[i]];
+        lits.clear();
+        for (int k = 0; k < c.size(); k++)
+            lits.push(c[k]);
+        to.addClause_(lits);
+    }
+}
+
+/*
+ * Incremental model evaluation: every original clause keeps the number of its literals that are
+ * true under the tracked assignment, so flipping a variable only touches the clauses containing it.
+ * The tracked assignment must not be changed other than by 'flipModelVar()'.
+ */
+
+void Solver::buildModelOccs()
+{
+    model_occ_start.clear();
+    model_occ_start.growTo(2*nVars() + 1, 0);
+    for (int i = 0; i < clauses.size(); i++){
+        const Clause& c = ca[clauses[i]];
+        for (int k = 0; k < c.size(); k++)
+            model_occ_start[toInt(c[k]) + 1]++;
+    }
+    for (int i = 1; i < model_occ_start.size(); i++)
+        model_occ_start[i] += model_occ_start[i-1];
+
+    vec<int> fill;
+    model_occ_start.copyTo(fill);
+    model_occ.clear();
+    model_occ.growTo(model_occ_start.last());
+    for (int i = 0; i < clauses.size(); i++){
+        const Clause& c = ca[clauses[i]];
+        for (int k = 0; k < c.size(); k++)
+            model_occ[fill[toInt(c[k])]++] = i;
+    }
+    model_occ_built = true;
+}
+
+void Solver::loadModel(const vec<lbool>& inAssign)
+{
+	TRACE_START_FUNC;
+	assert (inAssign.size() == nVars());
+	if (!model_occ_built) buildModelOccs();
+	model_true_cnt.clear();
+	model_true_cnt.growTo(clauses.size(), 0);
+	model_false_idx.clear();
+	model_false_idx.growTo(clauses.size(), -1);
+	model_false.clear();
+	foreach(i, clauses.size())
+	{
+		Clause& c = ca[clauses[i]];
+		foreach(j, c.size())
+		{
+			if (sign(c[j]) != (inAssign[var(c[j])] == l_True))
+				model_true_cnt[i]++;
+		}
+		if (model_true_cnt[i] == 0)
+		{
+			model_false_idx[i] = model_false.size();
+			model_false.push(i);
+		}
+	}
+	TRACE_END_FUNC;
+}
+
+void Solver::flipModelVar(vec<lbool>& inAssign, Var v)
+{
+	assert (model_occ_built);
+	assert (inAssign[v] != l_Undef);
+	Lit becomesFalse = mkLit(v, inAssign[v] != l_True); // the literal that is true before the flip
+	Lit becomesTrue  = ~becomesFalse;
+	inAssign[v] = ~inAssign[v];
+
+	for (int k = model_occ_start[toInt(becomesTrue)]; k < model_occ_start[toInt(becomesTrue) + 1]; k++)
+	{
+		int i = model_occ[k];
+		if (model_true_cnt[i]++ == 0)
+		{
+			// removing clause i from model_false:
+			int last = model_false.last();
+			model_false[model_false_idx[i]] = last;
+			model_false_idx[last] = model_false_idx[i];
+			model_false.pop();
+			model_false_idx[i] = -1;
+		}
+	}
+	for (int k = model_occ_start[toInt(becomesFalse)]; k < model_occ_start[toInt(becomesFalse) + 1]; k++)
+	{
+		int i = model_occ[k];
+		if (--model_true_cnt[i] == 0)
+		{
+			model_false_idx[i] = model_false.size();
+			model_false.push(i);
+		}
+	}
+}
+
+/*
+ * Bit-parallel model evaluation: lane i (bit i of a uint64_t) stands for 'inAssign' with every
+ * 'flips[j]' for which bit i of 'lanes[j]' is set flipped. The result has bit i set iff the
+ * assignment of lane i satisfies the CNF (lanes that no variable is flipped in are ignored).
+ * Lanes are plain 64 bit words, so every clause is evaluated for all the lanes at once.
+ */
+
+inline uint64_t Solver::satisfiedLanes(const Clause& c, const vec<lbool>& inAssign) const
+{
+	uint64_t sat = 0;
+	foreach(j, c.size())
+	{
+		if (sign(c[j]) != (inAssign[var(c[j])] == l_True))
+			sat |= ~flip_lanes[var(c[j])];
+		else
+			sat |= flip_lanes[var(c[j])];
+	}
+	return sat;
+}
+
+/* A clause can only be falsified in a lane if it is falsified by the tracked assignment
+ * or it contains a variable that is flipped in the lane. */
+uint64_t Solver::checkIfModelsInc(const vec<lbool>& inAssign, const vec<Var>& flips, const vec<uint64_t>& lanes)
+{
+	TRACE_START_FUNC;
+	assert (model_occ_built);
+	assert (flips.size() == lanes.size());
+	uint64_t res = 0;
+	flip_lanes.growTo(nVars(), 0);
+	foreach(j, flips.size())
+	{
+		flip_lanes[flips[j]] ^= lanes[j];
+		res |= lanes[j];
+	}
+	for (int i = 0; i < model_false.size() && res != 0; i++)
+		res &= satisfiedLanes(ca[clauses[model_false[i]]], inAssign);
+	for (int j = 0; j < flips.size() && res != 0; j++)
+		for (int s = 0; s < 2; s++){
+			int p = toInt(mkLit(flips[j], s));
+			for (int k = model_occ_start[p]; k < model_occ_start[p + 1] && res != 0; k++)
+				res &= satisfiedLanes(ca[clauses[model_occ[k]]], inAssign);
+		}
+	foreach(j, flips.size()) flip_lanes[flips[j]] = 0;
+	TRACE_END_FUNC;
+	return res;
+}
+
 /**
  * These are inner functions for the solver, that is used by the AssumMinimiser
  */
@@ -976,33 +1245,55 @@ bool    Solver::checkIfModel(vec<lbool>& inAssign)
 // TODO: Better design, implement a method for the solver that returns all of the clauses.
 // TODO:Findind the
 
+void Solver::buildOccurs()
+{
+    TRACE_START_FUNC;
+    occurs.clear();
+    for (int v = 0; v < nVars(); v++){
+        occurs.init(mkLit(v, false));
+        occurs.init(mkLit(v, true )); }
+    for (int i = 0; i < clauses.size(); i++){
+        const Clause& c = ca[clauses[i]];
+        for (int k = 0; k < c.size(); k++)
+            occurs[c[k]].push(clauses[i]);
+    }
+    occurs_built = true;
+    TRACE_END_FUNC;
+}
+
 void Solver::getClausesContaining(Lit p, vec<vec<Lit>*>& res) {
 	TRACE_START_FUNC;
 	res.clear();
-    foreach(i, this->clauses.size()) {
-        Clause& currClause = ca[clauses[i]];
-        TRACE("Checking clause: " << currClause.toString() << " i = " << i);
-        if (currClause.contains(p)) {
-        	TRACE("    Added!");
-            res.push(currClause.toVec());
-        }
+	if (!occurs_built) buildOccurs();
+    const vec<CRef>& cs = occurs.lookup(p);
+    foreach(i, cs.size()) {
+        Clause& currClause = ca[cs[i]];
+        TRACE("Adding clause: " << currClause.toString() << " i = " << i);
+        res.push(currClause.toVec());
     }
     TRACE_END_FUNC;
 }
 
 
 
+int Solver::nClausesContaining(Lit p) {
+	if (!occurs_built) buildOccurs();
+	return occurs.lookup(p).size();
+}
+
 /*
  * Returns the clauses that contain p and are only satisfied by p.
  */
 void Solver::getWeakClausesContaining (Lit p, vec<vec<Lit>*>& res) {
 	TRACE_START_FUNC;
 	res.clear();
+	if (!occurs_built) buildOccurs();
+    const vec<CRef>& cs = occurs.lookup(p);
     this->assigns[var(p)] = ~this->assigns[var(p)];
-    foreach(i, this->clauses.size()) {
-        Clause& currClause = ca[clauses[i]];
+    foreach(i, cs.size()) {
+        Clause& currClause = ca[cs[i]];
         TRACE("Checking clause: " << currClause.toString() << " i = " << i);
-        if (currClause.contains(p) && !(this->satisfied(currClause))) {
+        if (!(this->satisfied(currClause))) {
         	TRACE("    Added!");
             res.push(currClause.toVec());
         }
@@ -30,6 +30,8 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 
 namespace Minisat {
 
+class ClauseExchange;
+
 //=================================================================================================
 // Solver -- the main class:
 
@@ -52,9 +54,16 @@ public:
     bool    addClause (Lit p, Lit q, Lit r);                    // Add a ternary clause to the solver. 
     bool    addClause_(      vec<Lit>& ps);                     // Add a clause to the solver without making superflous internal copy. Will
                                                                 // change the passed vector 'ps'.
+    void    copyProblemTo(Solver& to) const;                        // Adds the variables, original clauses and top-level assignments to 'to'.
     void    getWeakClausesContaining (Lit p, vec<vec<Lit>*>& res);
     void    getClausesContaining     (Lit p, vec<vec<Lit>*>& res);      // Stores all clauses containing p in res.
+    int     nClausesContaining       (Lit p);                           // The number of original clauses containing p.
     bool    checkIfModel(vec<lbool>& inAssigns);                    // checks of the given vector of literal satisfies the CNF
+    void    loadModel   (const vec<lbool>& inAssigns);              // Starts tracking 'inAssigns' incrementally (see 'flipModelVar()' and 'isModel()').
+    void    flipModelVar(vec<lbool>& inAssigns, Var v);             // Flips 'v' in the tracked assignment, only the clauses containing 'v' are updated.
+    bool    isModel     () const;                                   // O(1) version of 'checkIfModel()' for the tracked assignment.
+    uint64_t checkIfModelsInc(const vec<lbool>& inAssigns, const vec<Var>& flips, const vec<uint64_t>& lanes);
+                                                                    // Bit-parallel 'isModel()' of up to 64 flips of the tracked assignment, see Solver.cc.
 
     // Solving:
     //
@@ -93,6 +102,7 @@ public:
     int     nLearnts   ()      const;       // The current number of learnt clauses.
     int     nVars      ()      const;       // The current number of variables.
     int     nFreeVars  ()      const;
+    double  varActivity(Var x) const;       // The VSIDS activity of a variable.
 
     // Resource contraints:
     //
@@ -101,6 +111,11 @@ public:
     void    budgetOff();
     void    interrupt();          // Trigger a (potentially asynchronous) interruption of the solver.
     void    clearInterrupt();     // Clear interrupt indicator flag.
+    bool    interrupted() const;  // TRUE if 'interrupt()' was called since the flag was cleared.
+
+    // Clause sharing:
+    //
+    void    setExchange(ClauseExchange* ex, int id); // Exchange learnt clauses with other solvers of the same problem as solver number 'id' of 'ex'.
 
     // Memory managment:
     //
@@ -136,10 +151,28 @@ public:
     int       learntsize_adjust_start_confl;
     double    learntsize_adjust_inc;
 
+    int       share_max_len;      // Learnt clauses up to this size are exported to the exchange.                              (default 8)
+    int       share_max_lbd;      // So are learnt clauses with up to this many distinct decision levels.                      (default 2)
+
     // Statistics: (read-only member variable)
     //
     uint64_t solves, starts, decisions, rnd_decisions, propagations, conflicts;
     uint64_t dec_vars, clauses_literals, learnts_literals, max_literals, tot_literals;
+    uint64_t shared_exported, shared_imported;
+
+    // Static helpers:
+    //
+
+    // Returns a random float 0 <= x < 1. Seed must never be 0.
+    static inline double drand(double& seed) {
+        seed *= 1389796;
+        int q = (int)(seed / 2147483647);
+        seed -= (double)q * 2147483647;
+        return seed / 2147483647; }
+
+    // Returns a random integer 0 <= x < size. Seed must never be 0.
+    static inline int irand(double& seed, int size) {
+        return (int)(drand(seed) * size); }
 
     // Methods for communicating assumptions
     const Lit&      getAssumption(int i); //returns lit_Undef if i is out of range
@@ -167,6 +200,11 @@ protected:
         bool operator()(const Watcher& w) const { return ca[w.cref].mark() == 1; }
     };
 
+    struct ClauseDeleted {
+        const ClauseAllocator& ca;
+        explicit ClauseDeleted(const ClauseAllocator& _ca) : ca(_ca) {}
+        bool operator()(const CRef& cr) const { return ca[cr].mark() == 1; } };
+
     struct VarOrderLt {
         const vec<double>&  activity;
         bool operator () (Var x, Var y) const { return activity[x] > activity[y]; }
@@ -196,6 +234,19 @@ protected:
     Heap<VarOrderLt>    order_heap;       // A priority queue of variables ordered with respect to the variable activity.
     double              progress_estimate;// Set by 'search()'.
     bool                remove_satisfied; // Indicates whether possibly inefficient linear scan for satisfied clauses should be performed in 'simplify'.
+    OccLists<Lit, vec<CRef>, ClauseDeleted>
+                        occurs;           // 'occurs[lit]' is a list of the original clauses containing 'lit' (built lazily for the MCA queries).
+    bool                occurs_built;     // Indicates whether 'occurs' is built and has to be maintained.
+
+    // Incremental model evaluation (for the MCA queries):
+    //
+    vec<int>            model_occ_start;  // 'model_occ[model_occ_start[toInt(p)]..model_occ_start[toInt(p)+1]-1]' are the positions in 'clauses' of the clauses containing 'p'.
+    vec<int>            model_occ;
+    bool                model_occ_built;  // FALSE when 'clauses' was changed since 'model_occ' was built.
+    vec<int>            model_true_cnt;   // Number of true literals in each of the original clauses under the tracked assignment.
+    vec<int>            model_false;      // Positions of the original clauses that are falsified by the tracked assignment.
+    vec<int>            model_false_idx;  // Index of each original clause in 'model_false', -1 if it's satisfied.
+    vec<uint64_t>       flip_lanes;       // Temporary for 'checkIfModelsInc()', the lanes in which each variable is flipped.
 
     ClauseAllocator     ca;
 
@@ -217,6 +268,13 @@ protected:
     int64_t             propagation_budget; // -1 means no budget.
     bool                asynch_interrupt;
 
+    // Clause sharing:
+    //
+    ClauseExchange*     exchange;           // NULL means no sharing.
+    int                 exchange_id;
+    vec<int>            lbd_stamp;          // Temporary for 'exportLearnt()', the last export that counted each decision level.
+    int                 lbd_counter;
+
     // Main internal methods:
     //
     void     insertVarOrder   (Var x);                                                 // Insert a variable in the decision order priority queue.
@@ -230,10 +288,15 @@ protected:
     void     analyzeFinal     (Lit p, vec<Lit>& out_conflict);                         // COULD THIS BE IMPLEMENTED BY THE ORDINARIY "analyze" BY SOME REASONABLE GENERALIZATION?
     bool     litRedundant     (Lit p, uint32_t abstract_levels);                       // (helper method for 'analyze()')
     lbool    search           (int nof_conflicts);                                     // Search for a given number of conflicts.
+    void     exportLearnt     (const vec<Lit>& learnt);                                // Exports 'learnt' if it's short or has a low LBD.
+    bool     importShared     ();                                                      // Adds the clauses exported by the other solvers. FALSE means UNSAT.
     lbool    solve_           ();                                                      // Main solve method (assumptions given in 'assumptions').
     void     reduceDB         ();                                                      // Reduce the set of learnt clauses.
     void     removeSatisfied  (vec<CRef>& cs);                                         // Shrink 'cs' to contain only non-satisfied clauses.
     void     rebuildOrderHeap ();
+    void     buildOccurs      ();                                                      // Builds the occurrence lists of the original clauses.
+    void     buildModelOccs   ();                                                      // Builds 'model_occ' for the incremental model evaluation.
+    uint64_t satisfiedLanes   (const Clause& c, const vec<lbool>& inAssigns) const;    // The lanes (see 'checkIfModelsInc()') in which 'c' is satisfied.
 
     // Maintaining Variable/Clause activity:
     //
@@ -261,20 +324,6 @@ protected:
     int      level            (Var x) const;
     double   progressEstimate ()      const; // DELETE THIS ?? IT'S NOT VERY USEFUL ...
     bool     withinBudget     ()      const;
-
-    // Static helpers:
-    //
-
-    // Returns a random float 0 <= x < 1. Seed must never be 0.
-    static inline double drand(double& seed) {
-        seed *= 1389796;
-        int q = (int)(seed / 2147483647);
-        seed -= (double)q * 2147483647;
-        return seed / 2147483647; }
-
-    // Returns a random integer 0 <= x < size. Seed must never be 0.
-    static inline int irand(double& seed, int size) {
-        return (int)(drand(seed) * size); }
 };
 
 
@@ -334,6 +383,7 @@ inline int      Solver::nClauses      ()      const   { return clauses.size(); }
 inline int      Solver::nLearnts      ()      const   { return learnts.size(); }
 inline int      Solver::nVars         ()      const   { return vardata.size(); }
 inline int      Solver::nFreeVars     ()      const   { return (int)dec_vars - (trail_lim.size() == 0 ? trail.size() : trail_lim[0]); }
+inline double   Solver::varActivity   (Var x) const   { return activity[x]; }
 inline void     Solver::setPolarity   (Var v, bool b) { polarity[v] = b; }
 inline void     Solver::setDecisionVar(Var v, bool b) 
 { 
@@ -345,11 +395,13 @@ inline void     Solver::setDecisionVar(Var v, bool b)
 }
 inline void     Solver::setConfBudget(int64_t x){ conflict_budget    = conflicts    + x; }
 inline void     Solver::setPropBudget(int64_t x){ propagation_budget = propagations + x; }
-inline void     Solver::interrupt(){ asynch_interrupt = true; }
-inline void     Solver::clearInterrupt(){ asynch_interrupt = false; }
+// The interrupts may come from other threads (see Portfolio), so the flag is accessed atomically:
+inline void     Solver::interrupt(){ __atomic_store_n(&asynch_interrupt, true, __ATOMIC_RELAXED); }
+inline void     Solver::clearInterrupt(){ __atomic_store_n(&asynch_interrupt, false, __ATOMIC_RELAXED); }
+inline bool     Solver::interrupted() const { return __atomic_load_n(&asynch_interrupt, __ATOMIC_RELAXED); }
 inline void     Solver::budgetOff(){ conflict_budget = propagation_budget = -1; }
 inline bool     Solver::withinBudget() const {
-    return !asynch_interrupt &&
+    return !interrupted() &&
            (conflict_budget    < 0 || conflicts < (uint64_t)conflict_budget) &&
            (propagation_budget < 0 || propagations < (uint64_t)propagation_budget); }
 
@@ -363,6 +415,7 @@ inline bool     Solver::solve         (Lit p, Lit q, Lit r) { budgetOff(); assum
 inline bool     Solver::solve         (const vec<Lit>& assumps){ budgetOff(); assumps.copyTo(assumptions); return solve_() == l_True; }
 inline lbool    Solver::solveLimited  (const vec<Lit>& assumps){ assumps.copyTo(assumptions); return solve_(); }
 inline bool     Solver::okay          ()      const   { return ok; }
+inline bool     Solver::isModel       ()      const   { return model_false.size() == 0; }
 
 inline void        Solver::toDimacs     (const char* file){ vec<Lit> as; toDimacs(file, as); }
 inline void        Solver::toDimacs     (const char* file, Lit p){ vec<Lit> as; as.push(p); toDimacs(file, as); }
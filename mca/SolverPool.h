@@ -0,0 +1,99 @@
+/*
+ * SolverPool.h
+ *
+ *  A set of worker solvers, each one a clone of the same problem, that solve
+ *  a batch of assumption sets in parallel (one thread per worker). The workers
+ *  share their short learnt clauses through a ClauseExchange.
+ */
+
+#ifndef MCA_SOLVERPOOL_H_
+#define MCA_SOLVERPOOL_H_
+
+#include <pthread.h>
+
+#include "mca/Solver.h"
+#include "mca/ClauseExchange.h"
+#include "mca/global_defs.h"
+
+namespace Minisat {
+
+class SolverPool {
+	struct Job
+	{
+		Solver          *S;
+		const vec<Lit>  *assum;
+		lbool            ret;
+		pthread_t        thread;
+	};
+
+	vec<Solver*>    solvers;
+	vec<Job>        jobs;
+	ClauseExchange  exchange;
+
+	static void* runJob(void* arg);
+
+public:
+	/* creates n workers, each one with a copy of master's problem */
+	SolverPool(const Solver& master, int n) : exchange(n)
+	{
+		foreach(i, n)
+		{
+			solvers.push(new Solver);
+			solvers.last()->verbosity = 0;
+			master.copyProblemTo(*solvers.last());
+			if (n > 1) solvers.last()->setExchange(&exchange, i);
+		}
+	}
+	~SolverPool()
+	{
+		foreach(i, solvers.size()) delete solvers[i];
+	}
+
+	int      size      () const     { return solvers.size(); }
+	Solver&  operator[](int i)      { return *solvers[i]; }
+
+	/* solves worker i with assumps[i] for every i < assumps.size() <= size(), in parallel.
+	 * rets[i] is the result of worker i, its model/conflict are left in the worker. */
+	void     solveAll  (const vec<vec<Lit> >& assumps, vec<lbool>& rets);
+	/* interrupts all of the workers, safe to call from a signal handler */
+	void     interrupt ()           { foreach(i, solvers.size()) solvers[i]->interrupt(); }
+};
+
+void* SolverPool::runJob(void* arg)
+{
+	Job& job = *(Job*)arg;
+	try {
+		job.ret = job.S->solveLimited(*job.assum);
+	} catch (OutOfMemoryException&) {
+		job.ret = l_Undef;
+	}
+	return NULL;
+}
+
+void SolverPool::solveAll(const vec<vec<Lit> >& assumps, vec<lbool>& rets)
+{
+	assert(assumps.size() <= solvers.size());
+	jobs.clear();
+	jobs.growTo(assumps.size());
+	foreach(i, assumps.size())
+	{
+		jobs[i].S     = solvers[i];
+		jobs[i].assum = &assumps[i];
+		jobs[i].ret   = l_Undef;
+	}
+	/* worker 0 runs in the calling thread */
+	foreach(i, jobs.size())
+	{
+		if (i > 0 && pthread_create(&jobs[i].thread, NULL, runJob, &jobs[i]) != 0)
+			printf("ERROR! Could not create thread %d\n", i), exit(1);
+	}
+	if (jobs.size() > 0) runJob(&jobs[0]);
+	for (int i = 1; i < jobs.size(); ++i) pthread_join(jobs[i].thread, NULL);
+
+	rets.clear();
+	foreach(i, jobs.size()) rets.push(jobs[i].ret);
+}
+
+}
+
+#endif /* MCA_SOLVERPOOL_H_ */
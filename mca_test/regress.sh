@@ -0,0 +1,173 @@
+#!/bin/bash
+#################################################################################################################
+# Regression checks of mca and pp, on the small formulas of this directory.
+# regress.sh [-update]
+# Each check runs mca and compares its output file with expected/<name>.out, -update rewrites them instead.
+# The parallel algorithms may find another set on each run, their result is only checked to be minimal.
+# pp is compared with pp.sh, except on empty lines (see the README).
+# The executables default to ../mca/mca and ../pp/pp, MCA and PP override them. The exit code is 0 iff
+# every check passed.
+#################################################################################################################
+
+cd "$(dirname "$0")" || exit 1
+MCA=${MCA:-../mca/mca}
+PP=${PP:-../pp/pp}
+
+update=0
+[[ "$1" == "-update" ]] && update=1
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+passed=0
+failed=0
+
+pass() { let passed++; }
+fail() { echo "FAIL: $1"; let failed++; }
+
+# same <name> <cnf> <options...>: the output file of mca must be expected/<name>.out
+same() {
+    local name=$1 cnf=$2
+    shift 2
+    timeout 60 $MCA "$cnf" "$@" -verb=0 "$tmp/$name.out" > "$tmp/$name.log" 2>&1
+    if (( update )); then cp "$tmp/$name.out" "expected/$name.out"; return; fi
+    if cmp -s "$tmp/$name.out" "expected/$name.out"; then pass; else fail "$name"; fi
+}
+
+# minimal <name> <cnf> <options...>: the result of mca must be a minimal conflicting set of assumptions,
+# so -alg=1 keeps all of it
+minimal() {
+    local name=$1 cnf=$2 lits
+    shift 2
+    (( update )) && return
+    timeout 60 $MCA "$cnf" "$@" -verb=0 "$tmp/$name.out" > "$tmp/$name.log" 2>&1
+    lits=$(sed -n 2p "$tmp/$name.out")
+    lits=${lits% 0}
+    { echo "p assumptions $(echo $lits | wc -w)"; for l in $lits; do echo $l; done; } > "$tmp/$name.assum"
+    timeout 60 $MCA "$cnf" -assum="$tmp/$name.assum" -alg=1 -verb=0 "$tmp/$name.chk" > /dev/null 2>&1
+    if [[ "$(head -1 "$tmp/$name.out")" == "Conflicting Assumptions:" && -n "$lits" &&
+          "$(sed -n 2p "$tmp/$name.chk")" == "$lits 0" ]]; then pass; else fail "$name"; fi
+}
+
+# rejected <name> <cnf> <options...>: mca must refuse the options, with an error and exit code 1
+rejected() {
+    local name=$1 cnf=$2
+    shift 2
+    (( update )) && return
+    timeout 60 $MCA "$cnf" "$@" -verb=0 > "$tmp/$name.log" 2>&1
+    if (( $? == 1 )) && grep -q "^ERROR!" "$tmp/$name.log"; then pass; else fail "$name"; fi
+}
+
+# streamed <name> <cnf> <options...>: with -stream, the output file must end with the result of the
+# same run without it, followed by the comment line of the stream
+streamed() {
+    local name=$1 cnf=$2
+    shift 2
+    (( update )) && return
+    timeout 60 $MCA "$cnf" "$@" -verb=0 "$tmp/$name.out" > /dev/null 2>&1
+    timeout 60 $MCA "$cnf" "$@" -stream -verb=0 "$tmp/$name.stream" > "$tmp/$name.log" 2>&1
+    if [[ "$(head -2 "$tmp/$name.stream")" == "$(cat "$tmp/$name.out")" &&
+          "$(sed -n 3p "$tmp/$name.stream")" == "c time "* ]]; then pass; else fail "$name"; fi
+}
+
+# like_pp_sh <name> <cnf>: pp must write what pp.sh writes
+like_pp_sh() {
+    local name=$1 cnf=$2
+    (( update )) && return
+    bash pp.sh "$cnf" "$tmp/$name.sh.cnf" "$tmp/$name.sh.assum" > /dev/null 2>&1
+    $PP "$cnf" "$tmp/$name.cnf" "$tmp/$name.assum" > /dev/null 2>&1
+    if cmp -s "$tmp/$name.cnf" "$tmp/$name.sh.cnf" && cmp -s "$tmp/$name.assum" "$tmp/$name.sh.assum"
+    then pass; else fail "$name"; fi
+}
+
+# same_pp <name> <cnf>: the outputs of pp must be expected/<name>.cnf and expected/<name>.assum
+same_pp() {
+    local name=$1 cnf=$2
+    $PP "$cnf" "$tmp/$name.cnf" "$tmp/$name.assum" > /dev/null 2>&1
+    if (( update )); then cp "$tmp/$name.cnf" "$tmp/$name.assum" expected/; return; fi
+    if cmp -s "$tmp/$name.cnf" "expected/$name.cnf" && cmp -s "$tmp/$name.assum" "expected/$name.assum"
+    then pass; else fail "$name"; fi
+}
+
+# Iterative Insertion (progression)
+for i in 1 2 3 4 5 6 7; do same alg3_f$i f$i.cnf -assum=a$i.cnf -alg=3; done
+# QuickXplain
+for i in 1 2 3 4 5 6 7; do same alg5_f$i f$i.cnf -assum=a$i.cnf -alg=5; done
+# Chunked Deletion
+for i in 1 2 3 4 5 6 7; do same alg6_f$i f$i.cnf -assum=a$i.cnf -alg=6; done
+# Parallel Iterative Deletion
+for i in 1 2 3 4 5 6 7; do minimal alg7_f$i f$i.cnf -assum=a$i.cnf -alg=7 -threads=4; done
+# Portfolio
+for i in 1 2 3 4 5 6 7; do minimal portfolio_f$i f$i.cnf -assum=a$i.cnf -portfolio=2,4,5:7,6; done
+# Smallest Set, too slow for f6 and f7
+for i in 1 2 3 4 5 9; do same alg8_f$i f$i.cnf -assum=a$i.cnf -alg=8; done
+# All of the minimal sets
+same all_f9 f9.cnf -assum=a9.cnf -all -alg=2
+same all_f9_resume f9.cnf -assum=a9.cnf -all -alg=2 -resume=expected/all_f9.out
+same all_f10 f10.cnf -assum=a10.cnf -all -alg=5
+same all_f6 f6.cnf -assum=a6.cnf -all -alg=2 -max-sets=5
+# Necessary Assumptions, it finds no minimal set to enumerate
+for i in 1 2 3 4 5 6 7 10; do same alg9_f$i f$i.cnf -assum=a$i.cnf -alg=9 -threads=4; done
+rejected all_alg9_f10 f10.cnf -assum=a10.cnf -all -alg=9
+# Budgets, the calls that run out of them are retried
+for a in 1 2 5; do minimal budget_conf_alg${a}_f6 f6.cnf -assum=a6.cnf -alg=$a -call-conf=5; done
+for a in 1 2 5; do minimal budget_prop_alg${a}_f6 f6.cnf -assum=a6.cnf -alg=$a -call-prop=200; done
+rejected budget_portfolio_f9 f9.cnf -assum=a9.cnf -portfolio=2,4 -call-conf=5
+rejected budget_all_f9 f9.cnf -assum=a9.cnf -all -call-prop=200
+# Deadline, f14 is interrupted while proving that {1} alone conflicts, and writes {1,2}
+same deadline_alg1_f14 f14.cnf -assum=a14.cnf -alg=1 -deadline=1
+same deadline_budget_alg2_f14 f14.cnf -assum=a14.cnf -alg=2 -deadline=1 -call-conf=100
+rejected deadline_portfolio_f9 f9.cnf -assum=a9.cnf -portfolio=2,4 -deadline=1
+rejected deadline_all_f9 f9.cnf -assum=a9.cnf -all -deadline=1
+# Streaming the smaller sets to the output file
+for a in 1 2 5 6; do streamed stream_alg${a}_f6 f6.cnf -assum=a6.cnf -alg=$a; done
+streamed stream_deadline_f14 f14.cnf -assum=a14.cnf -alg=1 -deadline=1
+streamed stream_alg8_f9 f9.cnf -assum=a9w.cnf -alg=8
+rejected stream_portfolio_f9 f9.cnf -assum=a9.cnf -portfolio=2,4 -stream
+rejected stream_all_f9 f9.cnf -assum=a9.cnf -all -stream
+# Core trimming before minimizing
+for a in 1 2 5; do minimal trim_alg${a}_f6 f6.cnf -assum=a6.cnf -trim=3 -alg=$a; done
+minimal trim_alg1_f7 f7.cnf -assum=a7.cnf -trim=3 -alg=1
+rejected trim_portfolio_f9 f9.cnf -assum=a9.cnf -portfolio=2,4 -trim=3
+rejected trim_all_f9 f9.cnf -assum=a9.cnf -all -trim=3
+# Hardening, only with the deletion algorithms
+for a in 1 2 4 6; do same harden_alg${a}_f6 f6.cnf -assum=a6.cnf -alg=$a -harden; done
+rejected harden_alg8_f9 f9.cnf -assum=a9.cnf -alg=8 -harden
+rejected harden_all_f9 f9.cnf -assum=a9.cnf -all -harden
+# Retiring, only with the deletion algorithms
+for a in 1 2 4 6; do same retire_alg${a}_f7 f7.cnf -assum=a7.cnf -alg=$a -retire; done
+rejected retire_alg8_f9 f9.cnf -assum=a9.cnf -alg=8 -retire
+rejected retire_portfolio_f9 f9.cnf -assum=a9.cnf -portfolio=2,4 -retire
+# The clauses of a plain CNF
+for a in 2 5; do same clausemus_alg${a}_f11 f11.cnf -clause-mus -alg=$a; done
+rejected clausemus_assum_f11 f11.cnf -clause-mus -assum=a9.cnf
+rejected clausemus_all_f11 f11.cnf -clause-mus -all
+# Groups of assumptions
+for a in 1 2 5 6; do same groups_alg${a}_f6 f6.cnf -assum=a6g.cnf -alg=$a; done
+same groups_alg8_f9 f9.cnf -assum=a9g.cnf -alg=8
+same groups_all_f9 f9.cnf -assum=a9g.cnf -all -alg=2
+# Weights
+same weights_alg8_f9 f9.cnf -assum=a9w.cnf -alg=8
+same weights_alg8_f12 f12.cnf -assum=a12w.cnf -alg=8
+same weights_order_f12 f12.cnf -assum=a12w.cnf -alg=2 -order=weight
+same weights_groups_f9 f9.cnf -assum=a9gw.cnf -alg=8
+rejected weights_heavy_f9 f9.cnf -assum=a9h.cnf -alg=8
+rejected weights_heavy_portfolio_f9 f9.cnf -assum=a9h.cnf -portfolio=2,8
+# A repeated assumption, and both polarities of a variable
+for a in 1 2 3 4 5 6 8 9; do same repeated_alg${a}_f13 f13.cnf -assum=a13r.cnf -alg=$a; done
+for a in 1 2 3 4 5 6 8 9; do same polarities_alg${a}_f13 f13.cnf -assum=a13n.cnf -alg=$a; done
+for a in r n; do minimal alg7_a13${a}_f13 f13.cnf -assum=a13$a.cnf -alg=7 -threads=4; done
+same repeated_all_f13 f13.cnf -assum=a13r.cnf -all -alg=2
+same polarities_all_f13 f13.cnf -assum=a13n.cnf -all -alg=2
+# pp, pp.sh writes the empty lines of f1 and f3 as empty clauses, pp skips them
+for i in 2 4 5 6 7 11; do like_pp_sh pp_f$i f$i.cnf; done
+for i in 1 3; do same_pp pp_f$i f$i.cnf; done
+if (( ! update )); then
+    gzip -c f6.cnf > "$tmp/f6.cnf.gz"
+    $PP "$tmp/f6.cnf.gz" "$tmp/pp_gz.cnf" "$tmp/pp_gz.assum" > /dev/null 2>&1
+    $PP f6.cnf "$tmp/pp_plain.cnf" "$tmp/pp_plain.assum" > /dev/null 2>&1
+    if cmp -s "$tmp/pp_gz.cnf" "$tmp/pp_plain.cnf" && cmp -s "$tmp/pp_gz.assum" "$tmp/pp_plain.assum"
+    then pass; else fail pp_gz_f6; fi
+fi
+
+if (( update )); then echo "Updated the expected outputs"; exit 0; fi
+echo "$passed passed, $failed failed"
+(( failed == 0 ))
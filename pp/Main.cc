@@ -0,0 +1,154 @@
+/*
+ * Main.cc
+ *
+ *  The compiled version of mca_test/pp.sh: adds a new negated selector literal to each
+ *  clause of a (plain or gzipped) CNF formula, and writes the selectors as the assumptions
+ *  of mca. The input is streamed, so the memory doesn't depend on the size of the formula.
+ *
+ *  usage: pp <input-file> [<cnf-output> [<assumptions-output>]]
+ *  the outputs default to "cnf_pp.cnf" and "assum_pp.cnf", as in pp.sh.
+ *  Unlike pp.sh, empty lines are skipped: pp.sh writes each one as an empty clause
+ *  and one more assumption, so their outputs differ on such input.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include "utils/ParseUtils.h"
+
+using namespace Minisat;
+
+//=================================================================================================
+// A simple buffered output stream, written in blocks of buffer_size:
+
+
+class OutBuffer {
+    FILE *out;
+    char  buf[buffer_size];
+    int   pos;
+
+public:
+    explicit OutBuffer(FILE* o) : out(o), pos(0) {}
+
+    void flush() {
+        if (pos > 0 && fwrite(buf, 1, pos, out) != (size_t)pos)
+            fprintf(stderr, "ERROR! Could not write the output: %s\n", strerror(errno)), exit(1);
+        pos = 0; }
+
+    void put   (char c)        { if (pos == buffer_size) flush(); buf[pos++] = c; }
+    void put   (const char* s) { while (*s != '\0') put(*s++); }
+    void putInt(int v) {
+        char     digits[16];
+        int      n = 0;
+        unsigned u = (v < 0) ? -(unsigned)v : v;
+        if (v < 0) put('-');
+        do digits[n++] = '0' + u % 10; while ((u /= 10) != 0);
+        while (n > 0) put(digits[--n]); }
+};
+
+
+// Skips the whitespace on the current line only, pp.sh works line by line.
+template<class B>
+static void skipBlanks(B& in) {
+    while (*in == ' ' || *in == '\t' || *in == '\r' || *in == '\v' || *in == '\f')
+        ++in; }
+
+
+static FILE* openOutput(const char* path)
+{
+    FILE* f = fopen(path, "wb");
+    if (f == NULL)
+        fprintf(stderr, "ERROR! Could not open file: %s\n", path), exit(1);
+    return f;
+}
+
+static void closeOutput(OutBuffer& buf, FILE* f)
+{
+    buf.flush();
+    if (fclose(f) != 0)
+        fprintf(stderr, "ERROR! Could not write the output: %s\n", strerror(errno)), exit(1);
+}
+
+//=================================================================================================
+// Main:
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 4)
+        printf("USAGE: %s <input-file> [<cnf-output> [<assumptions-output>]]\n"
+               "  Like mca_test/pp.sh, but empty lines are skipped (pp.sh writes them as empty clauses).\n", argv[0]), exit(1);
+
+    /* like pp.sh, the outputs are truncated first */
+    FILE* cnfFile   = openOutput(argc >= 3 ? argv[2] : "cnf_pp.cnf");
+    FILE* assumFile = openOutput(argc >= 4 ? argv[3] : "assum_pp.cnf");
+
+    gzFile in = gzopen(argv[1], "rb");
+    if (in == NULL)
+        printf("file does not exist\n"), exit(1);
+
+    StreamBuffer  *inBuf = new StreamBuffer(in);
+    OutBuffer     *cnf   = new OutBuffer(cnfFile);
+    OutBuffer     *assum = new OutBuffer(assumFile);
+    StreamBuffer&  s     = *inBuf;
+    bool           init  = false;
+    int            vars  = 0;
+    int            sel   = 0;   // the last selector, they follow the variables of the header
+
+    for (;;){
+        skipBlanks(s);
+        if (*s == EOF) break;
+        if (*s == '\n') {           // pp.sh breaks on empty lines, they are skipped
+            ++s;
+            continue; }
+        if (*s == 'c') {
+            cnf->put("c\n");
+            skipLine(s);
+            continue; }
+        if (*s == 'p') {
+            if (init)
+                printf("only one initialization line allowed, please fix!\n"), exit(2);
+            if (!eagerMatch(s, "p cnf"))
+                fprintf(stderr, "PARSE ERROR! Unexpected char: %c\n", *s), exit(3);
+            vars        = parseInt(s);
+            int clauses = parseInt(s);
+            skipLine(s);
+            cnf->put("p cnf "); cnf->putInt(vars + clauses); cnf->put(' '); cnf->putInt(clauses); cnf->put('\n');
+            assum->put("p assumptions "); assum->putInt(clauses); assum->put('\n');
+            sel  = vars;
+            init = true;
+            continue; }
+        if (!init)
+            printf("no initialization line before the cnf, usage: p cnf <num of vars> <num of clauses>\n"), exit(3);
+
+        /* the 0 that ends the clause is replaced by the negated selector */
+        sel++;
+        int  prev  = parseInt(s);
+        bool first = true;
+        for (;;){
+            skipBlanks(s);
+            if (*s == '\n' || *s == EOF) break;
+            int lit = parseInt(s);
+            if (!first) cnf->put(' ');
+            cnf->putInt(prev);
+            first = false;
+            prev  = lit;
+        }
+        if (prev != 0)
+            fprintf(stderr, "PARSE ERROR! Clause %d doesn't end with 0 on its line\n", sel - vars), exit(3);
+        if (!first) cnf->put(' ');
+        cnf->putInt(-sel); cnf->put(" 0\n");
+        assum->putInt(sel); assum->put('\n');
+    }
+
+    gzclose(in);
+    closeOutput(*cnf, cnfFile);
+    closeOutput(*assum, assumFile);
+    delete inBuf;
+    delete cnf;
+    delete assum;
+    return 0;
+}